@@ -0,0 +1,259 @@
+/*
+ * CS 261: Asynchronous output writer
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "asyncout.h"
+
+void *writer(void *arg);
+void *drain(void *arg);
+bool write_all(int fd, const byte_t *buf, size_t len);
+void wake(async_out_t *out, bool *waiting);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool async_open (async_out_t *out, int fd, size_t size)
+{
+    memset(out, 0x00, sizeof(async_out_t));
+
+    out->size = 1;
+    while (out->size < size) {
+        out->size <<= 1;
+    }
+    out->fd = fd;
+    out->data = (byte_t*)malloc(out->size);
+    if (out->data == NULL) {
+        return false;
+    }
+
+    pthread_mutex_init(&out->lock, NULL);
+    pthread_cond_init(&out->cond, NULL);
+    if (pthread_create(&out->thread, NULL, writer, out) != 0) {
+        pthread_mutex_destroy(&out->lock);
+        pthread_cond_destroy(&out->cond);
+        free(out->data);
+        return false;
+    }
+
+    return true;
+}
+
+void async_write (async_out_t *out, const void *buf, size_t len)
+{
+    const byte_t *src = (const byte_t*)buf;
+
+    while (len > 0) {
+        uint64_t head = out->head;
+        uint64_t tail = __atomic_load_n(&out->tail, __ATOMIC_ACQUIRE);
+        size_t space = out->size - (head - tail);
+
+        // back-pressure: sleep until the writer thread frees some space
+        if (space == 0) {
+            pthread_mutex_lock(&out->lock);
+            __atomic_store_n(&out->writer_waiting, true, __ATOMIC_SEQ_CST);
+            out->stalls++;
+            while (__atomic_load_n(&out->tail, __ATOMIC_SEQ_CST) == tail
+                  && !out->error) {
+                pthread_cond_wait(&out->cond, &out->lock);
+            }
+            __atomic_store_n(&out->writer_waiting, false, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&out->lock);
+            if (out->error) {
+                return;
+            }
+            continue;
+        }
+
+        // copy what fits, in at most two pieces around the end of the ring
+        size_t n = len < space ? len : space;
+        size_t at = head & (out->size - 1);
+        size_t first = n < out->size - at ? n : out->size - at;
+        memcpy(out->data + at, src, first);
+        memcpy(out->data, src + first, n - first);
+
+        __atomic_store_n(&out->head, head + n, __ATOMIC_SEQ_CST);
+        wake(out, &out->reader_waiting);
+
+        src += n;
+        len -= n;
+    }
+}
+
+bool async_close (async_out_t *out)
+{
+    pthread_mutex_lock(&out->lock);
+    __atomic_store_n(&out->done, true, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&out->cond);
+    pthread_mutex_unlock(&out->lock);
+
+    pthread_join(out->thread, NULL);
+    pthread_mutex_destroy(&out->lock);
+    pthread_cond_destroy(&out->cond);
+    free(out->data);
+    out->data = NULL;
+
+    return !out->error;
+}
+
+bool async_redirect (async_out_t *out, int fd, size_t size)
+{
+    memset(out, 0x00, sizeof(async_out_t));
+
+    int ends[2];
+    out->size = size;
+    out->target = fd;
+    out->fd = dup(fd);
+    out->data = (byte_t*)malloc(size);
+    if (out->fd < 0 || out->data == NULL || pipe(ends) != 0) {
+        if (out->fd >= 0) {
+            close(out->fd);
+        }
+        free(out->data);
+        return false;
+    }
+    out->source = ends[0];
+
+    // a larger pipe lets the producer run further ahead; keep the default
+    // if the system refuses
+    fcntl(ends[1], F_SETPIPE_SZ, (int) size);
+
+    bool ok = pthread_create(&out->thread, NULL, drain, out) == 0;
+    if (ok && dup2(ends[1], fd) < 0) {
+        // closing the only write end below ends the thread
+        close(ends[1]);
+        pthread_join(out->thread, NULL);
+        ok = false;
+    } else {
+        close(ends[1]);
+    }
+    if (!ok) {
+        close(out->fd);
+        close(out->source);
+        free(out->data);
+        return false;
+    }
+
+    return true;
+}
+
+bool async_restore (async_out_t *out)
+{
+    // replacing the last write end of the pipe lets the thread read to the
+    // end of it and finish
+    dup2(out->fd, out->target);
+    pthread_join(out->thread, NULL);
+
+    close(out->fd);
+    close(out->source);
+    free(out->data);
+    out->data = NULL;
+
+    return !out->error;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * writer thread: hand the file descriptor everything between tail and head,
+ * as few large writes as the ring's wrap-around allows
+ */
+void *writer(void *arg)
+{
+    async_out_t *out = (async_out_t*)arg;
+
+    while (true) {
+        uint64_t tail = out->tail;
+        uint64_t head = __atomic_load_n(&out->head, __ATOMIC_ACQUIRE);
+
+        if (head == tail) {
+            // nothing queued: finish if the producer is done, else sleep
+            pthread_mutex_lock(&out->lock);
+            __atomic_store_n(&out->reader_waiting, true, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&out->head, __ATOMIC_SEQ_CST) == tail
+                  && !__atomic_load_n(&out->done, __ATOMIC_SEQ_CST)) {
+                pthread_cond_wait(&out->cond, &out->lock);
+            }
+            __atomic_store_n(&out->reader_waiting, false, __ATOMIC_SEQ_CST);
+            bool finished = __atomic_load_n(&out->head, __ATOMIC_SEQ_CST) == tail;
+            pthread_mutex_unlock(&out->lock);
+            if (finished) {
+                return NULL;
+            }
+            continue;
+        }
+
+        size_t at = tail & (out->size - 1);
+        size_t n = head - tail;
+        if (n > out->size - at) {
+            n = out->size - at;
+        }
+
+        // after a failure keep draining, so the producer never blocks forever
+        if (!out->error && !write_all(out->fd, out->data + at, n)) {
+            out->error = true;
+        }
+
+        __atomic_store_n(&out->tail, tail + n, __ATOMIC_SEQ_CST);
+        wake(out, &out->writer_waiting);
+    }
+}
+
+/**
+ * redirect thread: copy the pipe to the original destination until every
+ * write end is closed
+ */
+void *drain(void *arg)
+{
+    async_out_t *out = (async_out_t*)arg;
+
+    while (true) {
+        ssize_t n = read(out->source, out->data, out->size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return NULL;
+        }
+
+        // after a failure keep draining, so the producer never blocks forever
+        if (!out->error && !write_all(out->fd, out->data, n)) {
+            out->error = true;
+        }
+    }
+}
+
+/**
+ * write a whole buffer, retrying short and interrupted writes
+ */
+bool write_all(int fd, const byte_t *buf, size_t len)
+{
+    for (size_t done = 0; done < len; ) {
+        ssize_t w = write(fd, buf + done, len - done);
+        if (w < 0 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        done += w;
+    }
+    return true;
+}
+
+/**
+ * wake the other side if it went to sleep; the flag is checked without the
+ * lock so the common case stays lock-free
+ */
+void wake(async_out_t *out, bool *waiting)
+{
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&out->lock);
+        pthread_cond_broadcast(&out->cond);
+        pthread_mutex_unlock(&out->lock);
+    }
+}
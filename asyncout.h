@@ -0,0 +1,108 @@
+#ifndef __CS261_ASYNCOUT__
+#define __CS261_ASYNCOUT__
+
+// F_SETPIPE_SZ is a Linux extension
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "y86.h"
+
+/* default ring capacity in bytes (a power of two) */
+#define ASYNC_RING_SIZE (1 << 22)
+
+/* stdio buffer for a redirected stream, so the pipe sees few large writes */
+#define ASYNC_STDIO_BUFFER (1 << 16)
+
+/* single-producer/single-consumer byte ring drained to a file descriptor by
+   a writer thread; head and tail only ever grow and are masked on use */
+typedef struct async_out {
+
+    byte_t *data;
+    size_t size;                // capacity, a power of two
+    uint64_t head;              // bytes published by the producer
+    uint64_t tail;              // bytes written out by the consumer
+    int fd;                     // destination
+
+    pthread_t thread;
+    pthread_mutex_t lock;       // only taken to sleep or wake a side
+    pthread_cond_t cond;
+    bool reader_waiting;        // writer thread is asleep on an empty ring
+    bool writer_waiting;        // producer is asleep on a full ring
+    bool done;                  // no more data will be produced
+    bool error;                 // a write to fd failed
+
+    uint64_t stalls;            // times the producer waited for space
+
+    int source;                 // read end of the pipe (async_redirect only)
+    int target;                 // descriptor pointed at the pipe
+
+} async_out_t;
+
+/**
+ * @brief Start a writer thread draining a new ring into a file descriptor
+ *
+ * @param out Ring to initialize
+ * @param fd Destination file descriptor (left open by async_close)
+ * @param size Ring capacity in bytes (rounded up to a power of two)
+ * @returns False if allocation or thread creation failed
+ */
+bool async_open (async_out_t *out, int fd, size_t size);
+
+/**
+ * @brief Queue bytes for the writer thread; waits while the ring is full
+ *
+ * Only one thread may call this for a given ring.
+ *
+ * @param out Ring to write to
+ * @param buf Bytes to queue
+ * @param len Number of bytes
+ */
+void async_write (async_out_t *out, const void *buf, size_t len);
+
+/**
+ * @brief Write out everything queued and stop the writer thread
+ *
+ * @param out Ring to close
+ * @returns False if any write failed
+ */
+bool async_close (async_out_t *out);
+
+/**
+ * @brief Point a file descriptor at a pipe that a writer thread drains to
+ * the descriptor's original destination
+ *
+ * This moves the output of a stream such as stdout off the calling thread
+ * without replacing the stream. Writes block only while the pipe is full,
+ * which keeps memory use bounded. The pipe is enlarged to size bytes where
+ * the system allows it.
+ *
+ * @param out Writer to initialize
+ * @param fd Descriptor to redirect
+ * @param size Pipe capacity and read buffer size in bytes
+ * @returns False if the pipe or thread could not be set up; fd is unchanged
+ */
+bool async_redirect (async_out_t *out, int fd, size_t size);
+
+/**
+ * @brief Point the descriptor back at its original destination, after the
+ * writer thread has written out everything in the pipe
+ *
+ * Flush any stream writing to the descriptor first.
+ *
+ * @param out Writer set up by async_redirect
+ * @returns False if any write failed
+ */
+bool async_restore (async_out_t *out);
+
+#endif
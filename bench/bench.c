@@ -0,0 +1,217 @@
+/*
+ * CS 261: Benchmark harness
+ *
+ * Runs each Mini-ELF workload through the simulator's -e path several times
+ * and reports wall time, its variation and instructions per second as CSV
+ * on standard out (progress goes to standard error). Build with
+ *
+ *   gcc -std=gnu99 -O2 -o bench-run bench/bench.c -lm
+ *
+ * Name: Dylan Moreno
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RUNS 5
+#define COUNT_PREFIX "Total execution count: "
+
+/* workloads run when no images are given on the command line */
+const char *default_images[] = {
+    "bench/images/arith.o",
+    "bench/images/recurse.o",
+    "bench/images/memcopy.o",
+    "bench/images/sort.o",
+    "bench/images/iotrap.o",
+};
+
+/**
+ * seconds on the monotonic clock
+ */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * run "simulator -e image" once, returning the wall time in seconds and the
+ * instruction count it reported, or a negative time on failure
+ */
+double run_once(const char *simulator, const char *image, uint64_t *count)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1.0;
+    }
+
+    double start = now();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1.0;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(simulator, simulator, "-e", image, (char*)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    // drain the output, keeping only the tail where the count is printed
+    char tail[4096];
+    size_t len = 0;
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) {
+        if ((size_t) n >= sizeof(tail)) {
+            memcpy(tail, chunk + n - sizeof(tail), sizeof(tail));
+            len = sizeof(tail);
+        } else {
+            if (len + n > sizeof(tail)) {
+                size_t drop = len + n - sizeof(tail);
+                memmove(tail, tail + drop, len - drop);
+                len -= drop;
+            }
+            memcpy(tail + len, chunk, n);
+            len += n;
+        }
+    }
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now() - start;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1.0;
+    }
+
+    char *found = memmem(tail, len, COUNT_PREFIX, strlen(COUNT_PREFIX));
+    if (found == NULL) {
+        return -1.0;
+    }
+    *count = strtoull(found + strlen(COUNT_PREFIX), NULL, 10);
+
+    return elapsed;
+}
+
+/**
+ * get the workload name from an image path (basename without extension)
+ */
+void workload_name(const char *image, char *name, size_t size)
+{
+    const char *base = strrchr(image, '/');
+    base = (base != NULL) ? base + 1 : image;
+
+    snprintf(name, size, "%s", base);
+    char *dot = strrchr(name, '.');
+    if (dot != NULL) {
+        *dot = '\0';
+    }
+}
+
+void usage(char **argv)
+{
+    printf("Usage: %s [-n runs] [-x simulator] [mini-elf-file ...]\n", argv[0]);
+    printf(" Options are:\n");
+    printf("  -h      Display usage\n");
+    printf("  -n runs Number of timed runs per workload (default %d)\n", DEFAULT_RUNS);
+    printf("  -x path Simulator binary to benchmark (default ./y86)\n");
+}
+
+int main (int argc, char **argv)
+{
+    int runs = DEFAULT_RUNS;
+    const char *simulator = "./y86";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:x:")) != -1) {
+        switch (opt) {
+            case 'h': usage(argv); return EXIT_SUCCESS;
+            case 'n': runs = atoi(optarg); break;
+            case 'x': simulator = optarg; break;
+            default: usage(argv); return EXIT_FAILURE;
+        }
+    }
+    if (runs < 1) {
+        usage(argv);
+        return EXIT_FAILURE;
+    }
+
+    const char **images = default_images;
+    int nimages = sizeof(default_images) / sizeof(default_images[0]);
+    if (optind < argc) {
+        images = (const char**) &argv[optind];
+        nimages = argc - optind;
+    }
+
+    // CSV contract, shared with microbench.c: one header row naming the
+    // columns, then one row per workload on standard out. Columns are never
+    // renamed, removed or reordered, only appended, so scripts comparing
+    // runs can read them by position. Times are seconds, rates per second.
+    printf("workload,runs,instructions,mean_sec,stddev_sec,min_sec,max_sec,inst_per_sec\n");
+
+    bool ok = true;
+    for (int i = 0; i < nimages; i++) {
+        char name[256];
+        uint64_t count = 0;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        double min = INFINITY;
+        double max = 0.0;
+
+        workload_name(images[i], name, sizeof(name));
+        fprintf(stderr, "%s:", name);
+
+        // one untimed warm-up run, then the measured runs
+        if (run_once(simulator, images[i], &count) < 0.0) {
+            fprintf(stderr, " failed\n");
+            ok = false;
+            continue;
+        }
+
+        int r;
+        for (r = 0; r < runs; r++) {
+            double t = run_once(simulator, images[i], &count);
+            if (t < 0.0) {
+                break;
+            }
+            sum += t;
+            sum_sq += t * t;
+            min = (t < min) ? t : min;
+            max = (t > max) ? t : max;
+            fprintf(stderr, " %.3fs", t);
+        }
+        fprintf(stderr, "\n");
+        if (r < runs) {
+            ok = false;
+            continue;
+        }
+
+        double mean = sum / runs;
+        double var = (runs > 1) ? (sum_sq - runs * mean * mean) / (runs - 1) : 0.0;
+        double stddev = sqrt(var > 0.0 ? var : 0.0);
+
+        printf("%s,%d,%" PRIu64 ",%.6f,%.6f,%.6f,%.6f,%.0f\n",
+                name, runs, count, mean, stddev, min, max, count / mean);
+        fflush(stdout);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+/*
+ * CS 261: Decoder and disassembler micro-benchmarks
+ *
+ * Measures the front end without the execution engine: fetch() over large
+ * sets of random valid and mixed valid/invalid byte streams, and
+ * disassemble_code() over synthetic code segments with standard out sent to
+ * /dev/null. Prints CSV on standard out. Build with
+ *
+ *   gcc -std=gnu99 -O2 -I. -o microbench bench/microbench.c p3-disas.c memhook.c
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "p3-disas.h"
+
+#define DEFAULT_BUFFERS 4096
+#define DEFAULT_PASSES 8
+
+/* leave room so no instruction reaches the end of the address space */
+#define CODE_LIMIT (MEMSIZE - 16)
+
+uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * xorshift64 pseudo-random generator (deterministic for a given seed)
+ */
+uint64_t rng()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/**
+ * seconds on the monotonic clock
+ */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * write one random valid instruction at buf[pos]; returns its length
+ */
+int random_inst(byte_t *buf, int pos)
+{
+    byte_t ra = rng() % NOREG;
+    byte_t rb = rng() % NOREG;
+    int len;
+
+    switch (rng() % 13) {
+        case HALT:   buf[pos] = 0x00; return 1;
+        case NOP:    buf[pos] = 0x10; return 1;
+        case RET:    buf[pos] = 0x90; return 1;
+        case IOTRAP: buf[pos] = 0xc0 | (rng() % 6); return 1;
+        case CMOV:   buf[pos] = 0x20 | (rng() % 7); buf[pos + 1] = (ra << 4) | rb; return 2;
+        case OPQ:    buf[pos] = 0x60 | (rng() % 4); buf[pos + 1] = (ra << 4) | rb; return 2;
+        case PUSHQ:  buf[pos] = 0xa0; buf[pos + 1] = (ra << 4) | 0xf; return 2;
+        case POPQ:   buf[pos] = 0xb0; buf[pos + 1] = (ra << 4) | 0xf; return 2;
+        case JUMP:   buf[pos] = 0x70 | (rng() % 7); len = 9; break;
+        case CALL:   buf[pos] = 0x80; len = 9; break;
+        case IRMOVQ: buf[pos] = 0x30; buf[pos + 1] = 0xf0 | rb; len = 10; break;
+        case RMMOVQ: buf[pos] = 0x40; buf[pos + 1] = (ra << 4) | rb; len = 10; break;
+        default:     buf[pos] = 0x50; buf[pos + 1] = (ra << 4) | rb; len = 10; break;
+    }
+
+    // constant or destination operand
+    uint64_t valC = rng() % MEMSIZE;
+    memcpy(&buf[pos + len - 8], &valC, 8);
+
+    return len;
+}
+
+/**
+ * fill a buffer with valid instructions; returns the bytes of code written
+ */
+int fill_valid(byte_t *buf)
+{
+    int pos = 0;
+
+    memset(buf, 0x10, MEMSIZE);
+    while (pos + 10 <= CODE_LIMIT) {
+        pos += random_inst(buf, pos);
+    }
+
+    return pos;
+}
+
+/**
+ * fill a buffer with a mix of valid instructions and random garbage bytes
+ */
+int fill_mixed(byte_t *buf)
+{
+    int pos = 0;
+
+    memset(buf, 0x00, MEMSIZE);
+    while (pos + 10 <= CODE_LIMIT) {
+        if (rng() % 2) {
+            pos += random_inst(buf, pos);
+        } else {
+            buf[pos++] = rng() & 0xff;
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * decode every buffer from start to end, stepping over invalid bytes
+ */
+void bench_fetch(const char *name, byte_t **bufs, int *sizes, int nbufs, int passes)
+{
+    uint64_t insts = 0;
+    uint64_t invalid = 0;
+    uint64_t bytes = 0;
+    y86_t cpu;
+
+    double start = now();
+    for (int p = 0; p < passes; p++) {
+        for (int b = 0; b < nbufs; b++) {
+            cpu.pc = 0;
+            while (cpu.pc < sizes[b]) {
+                cpu.stat = AOK;
+                y86_inst_t inst = fetch(&cpu, bufs[b]);
+                if (cpu.stat == AOK) {
+                    insts++;
+                    cpu.pc = inst.valP;
+                } else {
+                    invalid++;
+                    cpu.pc++;
+                }
+            }
+            bytes += sizes[b];
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("%s,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.6f,%.0f,%.0f\n",
+            name, passes, insts, invalid, bytes, elapsed,
+            (insts + invalid) / elapsed, bytes / elapsed);
+}
+
+/**
+ * disassemble every buffer as a code segment with standard out discarded
+ */
+void bench_disassemble(byte_t **bufs, int *sizes, int nbufs, int passes)
+{
+    uint64_t insts = 0;
+    uint64_t bytes = 0;
+    elf_hdr_t hdr;
+    elf_phdr_t phdr;
+
+    memset(&hdr, 0x00, sizeof(hdr));
+    memset(&phdr, 0x00, sizeof(phdr));
+    phdr.p_type = CODE;
+
+    // count the instructions once so the timed loop only disassembles
+    for (int b = 0; b < nbufs; b++) {
+        y86_t cpu = { .pc = 0, .stat = AOK };
+        while (cpu.pc < sizes[b]) {
+            cpu.pc = fetch(&cpu, bufs[b]).valP;
+            insts++;
+        }
+    }
+    insts *= passes;
+
+    // point standard out at the null device for the timed loop
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+
+    double start = now();
+    for (int p = 0; p < passes; p++) {
+        for (int b = 0; b < nbufs; b++) {
+            phdr.p_filesz = sizes[b];
+            disassemble_code(bufs[b], &phdr, &hdr);
+            bytes += sizes[b];
+        }
+    }
+    fflush(stdout);
+    double elapsed = now() - start;
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    printf("disassemble,%d,%" PRIu64 ",0,%" PRIu64 ",%.6f,%.0f,%.0f\n",
+            passes, insts, bytes, elapsed, insts / elapsed, bytes / elapsed);
+}
+
+void usage(char **argv)
+{
+    printf("Usage: %s [-b buffers] [-p passes] [-s seed]\n", argv[0]);
+    printf(" Options are:\n");
+    printf("  -h      Display usage\n");
+    printf("  -b n    Number of %d-byte buffers per benchmark (default %d)\n",
+            MEMSIZE, DEFAULT_BUFFERS);
+    printf("  -p n    Passes over the buffers (default %d)\n", DEFAULT_PASSES);
+    printf("  -s seed Random seed for the generated byte streams\n");
+}
+
+int main (int argc, char **argv)
+{
+    int nbufs = DEFAULT_BUFFERS;
+    int passes = DEFAULT_PASSES;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hb:p:s:")) != -1) {
+        switch (opt) {
+            case 'h': usage(argv); return EXIT_SUCCESS;
+            case 'b': nbufs = atoi(optarg); break;
+            case 'p': passes = atoi(optarg); break;
+            case 's': rng_state = strtoull(optarg, NULL, 0) | 1; break;
+            default: usage(argv); return EXIT_FAILURE;
+        }
+    }
+    if (nbufs < 1 || passes < 1) {
+        usage(argv);
+        return EXIT_FAILURE;
+    }
+
+    byte_t **valid = (byte_t**)calloc(nbufs, sizeof(byte_t*));
+    byte_t **mixed = (byte_t**)calloc(nbufs, sizeof(byte_t*));
+    int *valid_sizes = (int*)calloc(nbufs, sizeof(int));
+    int *mixed_sizes = (int*)calloc(nbufs, sizeof(int));
+    if (valid == NULL || mixed == NULL || valid_sizes == NULL || mixed_sizes == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    for (int b = 0; b < nbufs; b++) {
+        valid[b] = (byte_t*)malloc(MEMSIZE);
+        mixed[b] = (byte_t*)malloc(MEMSIZE);
+        if (valid[b] == NULL || mixed[b] == NULL) {
+            return EXIT_FAILURE;
+        }
+        valid_sizes[b] = fill_valid(valid[b]);
+        mixed_sizes[b] = fill_mixed(mixed[b]);
+    }
+
+    // one row per benchmark, under the CSV contract described in bench.c
+    printf("benchmark,passes,instructions,invalid,bytes,sec,decoded_per_sec,bytes_per_sec\n");
+    bench_fetch("fetch-valid", valid, valid_sizes, nbufs, passes);
+    bench_fetch("fetch-mixed", mixed, mixed_sizes, nbufs, passes);
+    bench_disassemble(valid, valid_sizes, nbufs, passes);
+
+    for (int b = 0; b < nbufs; b++) {
+        free(valid[b]);
+        free(mixed[b]);
+    }
+    free(valid);
+    free(mixed);
+    free(valid_sizes);
+    free(mixed_sizes);
+
+    return EXIT_SUCCESS;
+}
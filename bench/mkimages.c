@@ -0,0 +1,369 @@
+/*
+ * CS 261: Benchmark workload generator
+ *
+ * Writes the Mini-ELF images used by the benchmark harness. The images in
+ * bench/images are generated by this program; rebuild them with
+ *
+ *   gcc -std=gnu99 -I. -o mkimages bench/mkimages.c && ./mkimages bench/images
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elf.h"
+#include "y86.h"
+
+#define CODE_START 0x100
+#define DATA_START 0x800
+#define STACK_TOP  0xf00
+#define PHDR_MAGIC 0xDEADBEEF
+#define ELF_MAGIC  0x464c45
+
+/* program being assembled: one code segment and an optional data segment */
+typedef struct prog {
+
+    byte_t code[MEMSIZE];
+    int size;                   // bytes of code emitted so far
+    byte_t data[MEMSIZE];
+    int data_size;              // bytes of initialized data
+
+} prog_t;
+
+/**********************************************************************
+ *                         INSTRUCTION ENCODERS
+ *********************************************************************/
+
+/**
+ * current address, for use as a jump/call target
+ */
+address_t here(prog_t *p)
+{
+    return CODE_START + p->size;
+}
+
+void emit_byte(prog_t *p, byte_t b)
+{
+    p->code[p->size++] = b;
+}
+
+void emit_quad(prog_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        emit_byte(p, (v >> (8 * i)) & 0xff);
+    }
+}
+
+void emit_regs(prog_t *p, y86_regnum_t ra, y86_regnum_t rb)
+{
+    emit_byte(p, (ra << 4) | rb);
+}
+
+void halt(prog_t *p)    { emit_byte(p, HALT << 4); }
+void ret(prog_t *p)     { emit_byte(p, RET << 4); }
+void iotrap(prog_t *p, y86_iotrap_t trap) { emit_byte(p, (IOTRAP << 4) | trap); }
+
+void irmovq(prog_t *p, int64_t v, y86_regnum_t rb)
+{
+    emit_byte(p, IRMOVQ << 4);
+    emit_regs(p, NOREG, rb);
+    emit_quad(p, v);
+}
+
+void cmov(prog_t *p, y86_cmov_t fn, y86_regnum_t ra, y86_regnum_t rb)
+{
+    emit_byte(p, (CMOV << 4) | fn);
+    emit_regs(p, ra, rb);
+}
+
+void rmmovq(prog_t *p, y86_regnum_t ra, int64_t d, y86_regnum_t rb)
+{
+    emit_byte(p, RMMOVQ << 4);
+    emit_regs(p, ra, rb);
+    emit_quad(p, d);
+}
+
+void mrmovq(prog_t *p, int64_t d, y86_regnum_t rb, y86_regnum_t ra)
+{
+    emit_byte(p, MRMOVQ << 4);
+    emit_regs(p, ra, rb);
+    emit_quad(p, d);
+}
+
+void opq(prog_t *p, y86_op_t fn, y86_regnum_t ra, y86_regnum_t rb)
+{
+    emit_byte(p, (OPQ << 4) | fn);
+    emit_regs(p, ra, rb);
+}
+
+void pushq(prog_t *p, y86_regnum_t ra) { emit_byte(p, PUSHQ << 4); emit_regs(p, ra, NOREG); }
+void popq(prog_t *p, y86_regnum_t ra)  { emit_byte(p, POPQ << 4);  emit_regs(p, ra, NOREG); }
+
+/**
+ * emit a jump or call; returns the offset of its destination so forward
+ * references can be patched once the target is known
+ */
+int jxx(prog_t *p, y86_jump_t fn, address_t dest)
+{
+    emit_byte(p, (JUMP << 4) | fn);
+    emit_quad(p, dest);
+    return p->size - 8;
+}
+
+int call(prog_t *p, address_t dest)
+{
+    emit_byte(p, CALL << 4);
+    emit_quad(p, dest);
+    return p->size - 8;
+}
+
+void patch(prog_t *p, int fixup, address_t dest)
+{
+    for (int i = 0; i < 8; i++) {
+        p->code[fixup + i] = (dest >> (8 * i)) & 0xff;
+    }
+}
+
+/**********************************************************************
+ *                              WORKLOADS
+ *********************************************************************/
+
+/**
+ * tight register-only arithmetic loop
+ */
+void build_arith(prog_t *p)
+{
+    irmovq(p, 3000000, RCX);
+    irmovq(p, 1, RDX);
+    irmovq(p, 3, RBX);
+    irmovq(p, 0x55, RSI);
+
+    address_t loop = here(p);
+    opq(p, ADD, RBX, RAX);
+    opq(p, XOR, RSI, RAX);
+    opq(p, AND, RAX, RDI);
+    opq(p, ADD, RDX, R8);
+    opq(p, SUB, RDX, RCX);
+    jxx(p, JNE, loop);
+    halt(p);
+}
+
+/**
+ * recursive sum(n) = n + sum(n - 1), called repeatedly
+ */
+void build_recurse(prog_t *p)
+{
+    irmovq(p, STACK_TOP, RSP);
+    irmovq(p, 40000, R12);
+    irmovq(p, 1, RDX);
+
+    address_t outer = here(p);
+    irmovq(p, 64, RDI);
+    int to_sum = call(p, 0);
+    opq(p, SUB, RDX, R12);
+    jxx(p, JNE, outer);
+    halt(p);
+
+    // sum: returns %rax = %rdi + sum(%rdi - 1)
+    patch(p, to_sum, here(p));
+    address_t sum = here(p);
+    opq(p, AND, RDI, RDI);
+    int to_base = jxx(p, JE, 0);
+    pushq(p, RDI);
+    opq(p, SUB, RDX, RDI);
+    call(p, sum);
+    popq(p, RDI);
+    opq(p, ADD, RDI, RAX);
+    ret(p);
+
+    patch(p, to_base, here(p));
+    irmovq(p, 0, RAX);
+    ret(p);
+}
+
+/**
+ * streaming copy of a 1 KiB buffer, repeated
+ */
+void build_memcopy(prog_t *p)
+{
+    irmovq(p, 27000, R12);
+    irmovq(p, 8, R8);
+    irmovq(p, 1, RDX);
+
+    address_t outer = here(p);
+    irmovq(p, DATA_START, RSI);
+    irmovq(p, DATA_START + 0x400, RDI);
+    irmovq(p, 128, RCX);
+
+    address_t loop = here(p);
+    mrmovq(p, 0, RSI, RAX);
+    rmmovq(p, RAX, 0, RDI);
+    opq(p, ADD, R8, RSI);
+    opq(p, ADD, R8, RDI);
+    opq(p, SUB, RDX, RCX);
+    jxx(p, JNE, loop);
+
+    opq(p, SUB, RDX, R12);
+    jxx(p, JNE, outer);
+    halt(p);
+
+    // source buffer
+    for (int i = 0; i < 128; i++) {
+        uint64_t v = 0x0123456789abcdefULL ^ (uint64_t) i * 0x9e3779b97f4a7c15ULL;
+        memcpy(&p->data[8 * i], &v, 8);
+    }
+    p->data_size = 0x400;
+}
+
+/**
+ * bubble sort of a freshly scrambled 32-element array, repeated
+ */
+void build_sort(prog_t *p)
+{
+    irmovq(p, 5000, R12);
+    irmovq(p, 8, R8);
+    irmovq(p, 1, RDX);
+    irmovq(p, 0x5851f42d4c957f2dLL, R9);
+    irmovq(p, 0x14057b7ef767814fLL, R11);
+
+    // scramble the array with an add/xor generator
+    address_t outer = here(p);
+    irmovq(p, DATA_START, RSI);
+    irmovq(p, 32, RCX);
+    address_t fill = here(p);
+    opq(p, ADD, R9, R10);
+    opq(p, XOR, R11, R10);
+    rmmovq(p, R10, 0, RSI);
+    opq(p, ADD, R8, RSI);
+    opq(p, SUB, RDX, RCX);
+    jxx(p, JNE, fill);
+
+    // for i = 31 .. 1: for j = 0 .. i - 1: swap a[j], a[j + 1] if out of order
+    irmovq(p, 31, R13);
+    address_t pass = here(p);
+    irmovq(p, DATA_START, RSI);
+    cmov(p, RRMOVQ, R13, RCX);
+    address_t inner = here(p);
+    mrmovq(p, 0, RSI, RAX);
+    mrmovq(p, 8, RSI, RBX);
+    cmov(p, RRMOVQ, RAX, RDI);
+    opq(p, SUB, RBX, RDI);
+    int to_next = jxx(p, JLE, 0);
+    rmmovq(p, RBX, 0, RSI);
+    rmmovq(p, RAX, 8, RSI);
+    patch(p, to_next, here(p));
+    opq(p, ADD, R8, RSI);
+    opq(p, SUB, RDX, RCX);
+    jxx(p, JNE, inner);
+    opq(p, SUB, RDX, R13);
+    jxx(p, JNE, pass);
+
+    opq(p, SUB, RDX, R12);
+    jxx(p, JNE, outer);
+    halt(p);
+
+    p->data_size = 32 * 8;
+}
+
+/**
+ * I/O trap heavy loop that flushes the output buffer every 64 iterations
+ */
+void build_iotrap(prog_t *p)
+{
+    irmovq(p, 2500000, RCX);
+    irmovq(p, 1, RDX);
+    irmovq(p, 63, R9);
+
+    address_t loop = here(p);
+    iotrap(p, CHAROUT);
+    iotrap(p, DECOUT);
+    iotrap(p, STROUT);
+    cmov(p, RRMOVQ, RCX, RAX);
+    opq(p, AND, R9, RAX);
+    int to_skip = jxx(p, JNE, 0);
+    iotrap(p, FLUSH);
+    patch(p, to_skip, here(p));
+    opq(p, SUB, RDX, RCX);
+    jxx(p, JNE, loop);
+    halt(p);
+}
+
+/**********************************************************************
+ *                           IMAGE WRITER
+ *********************************************************************/
+
+/**
+ * write a program as a Mini-ELF file with a code and (optional) data segment
+ */
+bool write_image(const char *dir, const char *name, prog_t *p)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.o", dir, name);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint16_t nphdrs = (p->data_size > 0) ? 2 : 1;
+    uint32_t offset = sizeof(elf_hdr_t) + nphdrs * sizeof(elf_phdr_t);
+
+    elf_hdr_t hdr = {
+        .e_version = 1, .e_entry = CODE_START, .e_phdr_start = sizeof(elf_hdr_t),
+        .e_num_phdr = nphdrs, .e_symtab = 0, .e_strtab = 0, .magic = ELF_MAGIC
+    };
+    elf_phdr_t code = {
+        .p_offset = offset, .p_filesz = p->size, .p_vaddr = CODE_START,
+        .p_type = CODE, .p_flag = 5, .magic = PHDR_MAGIC
+    };
+    elf_phdr_t data = {
+        .p_offset = offset + p->size, .p_filesz = p->data_size, .p_vaddr = DATA_START,
+        .p_type = DATA, .p_flag = 6, .magic = PHDR_MAGIC
+    };
+
+    fwrite(&hdr, sizeof(hdr), 1, file);
+    fwrite(&code, sizeof(code), 1, file);
+    if (nphdrs == 2) {
+        fwrite(&data, sizeof(data), 1, file);
+    }
+    fwrite(p->code, 1, p->size, file);
+    fwrite(p->data, 1, p->data_size, file);
+
+    return fclose(file) == 0;
+}
+
+int main (int argc, char **argv)
+{
+    const char *dir = (argc > 1) ? argv[1] : "bench/images";
+
+    struct {
+        const char *name;
+        void (*build) (prog_t *p);
+    } workloads[] = {
+        { "arith",   build_arith },
+        { "recurse", build_recurse },
+        { "memcopy", build_memcopy },
+        { "sort",    build_sort },
+        { "iotrap",  build_iotrap },
+    };
+
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        prog_t *p = (prog_t*)calloc(1, sizeof(prog_t));
+        if (p == NULL) {
+            return EXIT_FAILURE;
+        }
+        workloads[i].build(p);
+        if (!write_image(dir, workloads[i].name, p)) {
+            printf("Failed to write %s/%s.o\n", dir, workloads[i].name);
+            free(p);
+            return EXIT_FAILURE;
+        }
+        free(p);
+    }
+
+    return EXIT_SUCCESS;
+}
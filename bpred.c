@@ -0,0 +1,234 @@
+/*
+ * CS 261: Branch predictor simulation
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "bpred.h"
+
+bool bpred_predict(bpred_t *bp, address_t pc, address_t dest, uint64_t *index);
+void bpred_train(bpred_t *bp, uint64_t index, bool taken);
+const char *bpred_name(bpred_kind_t kind);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool bpred_init (bpred_t *bp, const char *spec)
+{
+    // check for bad parameters
+    if (bp == NULL || spec == NULL) {
+        return false;
+    }
+
+    memset(bp, 0x00, sizeof(bpred_t));
+    bp->bits = BPRED_BITS;
+    bp->ras_depth = RAS_DEPTH;
+
+    // split the specification into the kind and up to two sizes, and note
+    // where each field ended so nothing may follow the last one
+    char kind[16];
+    int sizes[2];
+    int ends[3] = { 0, 0, 0 };
+    int fields = sscanf(spec, "%15[a-z]%n:%d%n:%d%n", kind, &ends[0],
+            &sizes[0], &ends[1], &sizes[1], &ends[2]);
+    if (fields < 1 || spec[ends[fields - 1]] != '\0') {
+        return false;
+    }
+
+    if (strcmp(kind, "taken") == 0) {
+        bp->kind = BP_TAKEN;
+    } else if (strcmp(kind, "btfnt") == 0) {
+        bp->kind = BP_BTFNT;
+    } else if (strcmp(kind, "bimodal") == 0) {
+        bp->kind = BP_BIMODAL;
+    } else if (strcmp(kind, "gshare") == 0) {
+        bp->kind = BP_GSHARE;
+    } else {
+        return false;
+    }
+
+    // the counter predictors take a table size and stack depth; the static
+    // ones have no table, so their only size is the stack depth
+    if (bp->kind == BP_BIMODAL || bp->kind == BP_GSHARE) {
+        if (fields > 1) {
+            bp->bits = sizes[0];
+        }
+        if (fields > 2) {
+            bp->ras_depth = sizes[1];
+        }
+    } else if (fields > 2) {
+        return false;
+    } else if (fields > 1) {
+        bp->ras_depth = sizes[0];
+    }
+    if (bp->bits < 1 || bp->bits > BPRED_MAX_BITS || bp->ras_depth < 0) {
+        return false;
+    }
+
+    // counters start weakly taken to match the static PIPE prediction
+    if (bp->kind == BP_BIMODAL || bp->kind == BP_GSHARE) {
+        bp->counters = (byte_t*)malloc((size_t)1 << bp->bits);
+        if (bp->counters == NULL) {
+            return false;
+        }
+        memset(bp->counters, 2, (size_t)1 << bp->bits);
+    }
+
+    bp->ras = (address_t*)calloc(bp->ras_depth + 1, sizeof(address_t));
+    bp->execs = (uint64_t*)calloc(MEMSIZE, sizeof(uint64_t));
+    bp->taken = (uint64_t*)calloc(MEMSIZE, sizeof(uint64_t));
+    bp->misses = (uint64_t*)calloc(MEMSIZE, sizeof(uint64_t));
+    if (bp->ras == NULL || bp->execs == NULL || bp->taken == NULL || bp->misses == NULL) {
+        bpred_free(bp);
+        return false;
+    }
+
+    return true;
+}
+
+void bpred_free (bpred_t *bp)
+{
+    free(bp->counters);
+    free(bp->ras);
+    free(bp->execs);
+    free(bp->taken);
+    free(bp->misses);
+    memset(bp, 0x00, sizeof(bpred_t));
+}
+
+void bpred_step (bpred_t *bp, address_t pc, y86_inst_t inst, bool cnd,
+        address_t next_pc)
+{
+    bool miss;
+    uint64_t index = 0;
+
+    switch (inst.icode) {
+        case JUMP:
+            // unconditional jumps are resolved in decode
+            if (inst.ifun.jump == JMP) {
+                return;
+            }
+            miss = bpred_predict(bp, pc, inst.valC.dest, &index) != cnd;
+            bpred_train(bp, index, cnd);
+            bp->cond++;
+            bp->cond_miss += miss;
+            bp->taken[pc] += cnd;
+            break;
+        case CALL:
+            // push the return address, overwriting the oldest on overflow
+            if (bp->ras_depth > 0) {
+                bp->ras[bp->ras_top] = inst.valP;
+                bp->ras_top = (bp->ras_top + 1) % bp->ras_depth;
+                if (bp->ras_count < bp->ras_depth) {
+                    bp->ras_count++;
+                }
+            }
+            return;
+        case RET:
+            // an empty stack cannot supply a target
+            miss = true;
+            if (bp->ras_count > 0) {
+                bp->ras_top = (bp->ras_top + bp->ras_depth - 1) % bp->ras_depth;
+                bp->ras_count--;
+                miss = bp->ras[bp->ras_top] != next_pc;
+            }
+            bp->rets++;
+            bp->ret_miss += miss;
+            bp->taken[pc]++;
+            break;
+        default:
+            return;
+    }
+
+    bp->execs[pc]++;
+    bp->misses[pc] += miss;
+}
+
+void dump_bpred_stats (bpred_t *bp)
+{
+    printf("Branch predictor: %s", bpred_name(bp->kind));
+    if (bp->counters != NULL) {
+        printf(" (%d entries)", 1 << bp->bits);
+    }
+    printf(", %d-entry return stack\n", bp->ras_depth);
+
+    printf("  Conditional jumps: %8" PRIu64 "   Mispredicted: %8" PRIu64 " (%.2f%%)\n",
+            bp->cond, bp->cond_miss,
+            bp->cond > 0 ? 100.0 * bp->cond_miss / bp->cond : 0.0);
+    printf("  Returns:           %8" PRIu64 "   Mispredicted: %8" PRIu64 " (%.2f%%)\n",
+            bp->rets, bp->ret_miss,
+            bp->rets > 0 ? 100.0 * bp->ret_miss / bp->rets : 0.0);
+
+    // per-branch breakdown, in address order
+    printf("  Branch PC     Executed       Taken  Mispredicted    Rate\n");
+    for (int pc = 0; pc < MEMSIZE; pc++) {
+        if (bp->execs[pc] == 0) {
+            continue;
+        }
+        printf("  0x%04x    %10" PRIu64 "  %10" PRIu64 "    %10" PRIu64 "  %5.1f%%\n",
+                pc, bp->execs[pc], bp->taken[pc], bp->misses[pc],
+                100.0 * bp->misses[pc] / bp->execs[pc]);
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * predict the direction of a conditional jump, returning the table index
+ * used so the same entry can be trained afterwards
+ */
+bool bpred_predict(bpred_t *bp, address_t pc, address_t dest, uint64_t *index)
+{
+    uint64_t mask = ((uint64_t)1 << bp->bits) - 1;
+
+    switch (bp->kind) {
+        case BP_TAKEN:
+            return true;
+        case BP_BTFNT:
+            return dest <= pc;
+        case BP_BIMODAL:
+            *index = pc & mask;
+            return bp->counters[*index] >= 2;
+        case BP_GSHARE:
+            *index = (pc ^ bp->history) & mask;
+            return bp->counters[*index] >= 2;
+    }
+
+    return true;
+}
+
+/**
+ * update the saturating counter and global history with the real outcome
+ */
+void bpred_train(bpred_t *bp, uint64_t index, bool taken)
+{
+    if (bp->counters == NULL) {
+        return;
+    }
+
+    if (taken && bp->counters[index] < 3) {
+        bp->counters[index]++;
+    } else if (!taken && bp->counters[index] > 0) {
+        bp->counters[index]--;
+    }
+
+    bp->history = (bp->history << 1) | taken;
+}
+
+/**
+ * get the printable name of a predictor kind
+ */
+const char *bpred_name(bpred_kind_t kind)
+{
+    switch (kind) {
+        case BP_TAKEN:   return "always taken";
+        case BP_BTFNT:   return "backward taken/forward not taken";
+        case BP_BIMODAL: return "bimodal 2-bit";
+        case BP_GSHARE:  return "gshare";
+    }
+
+    return "unknown";
+}
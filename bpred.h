@@ -0,0 +1,92 @@
+#ifndef __CS261_BPRED__
+#define __CS261_BPRED__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "y86.h"
+
+/* default and maximum predictor table sizes (log2 of the entry count) */
+#define BPRED_BITS 10
+#define BPRED_MAX_BITS 20
+
+/* default return address stack depth */
+#define RAS_DEPTH 16
+
+/* supported direction predictors */
+typedef enum {
+    BP_TAKEN = 0, BP_BTFNT, BP_BIMODAL, BP_GSHARE
+} bpred_kind_t;
+
+/* branch predictor state and statistics */
+typedef struct bpred {
+
+    bpred_kind_t kind;          // direction predictor in use
+    int bits;                   // log2 of the counter table size
+    byte_t *counters;           // 2-bit saturating counters (bimodal, gshare)
+    uint64_t history;           // global branch history (gshare)
+
+    address_t *ras;             // return address stack
+    int ras_depth;              // number of return stack entries
+    int ras_top;                // index of the next free return stack entry
+    int ras_count;              // number of valid return stack entries
+
+    uint64_t cond;              // conditional jumps seen
+    uint64_t cond_miss;         // conditional jumps mispredicted
+    uint64_t rets;              // returns seen
+    uint64_t ret_miss;          // returns mispredicted
+
+    uint64_t *execs;            // per-PC branch executions
+    uint64_t *taken;            // per-PC taken branches
+    uint64_t *misses;           // per-PC mispredictions
+
+} bpred_t;
+
+/**
+ * @brief Set up a branch predictor from a command-line specification
+ *
+ * The specification is taken[:ras], btfnt[:ras], bimodal[:bits[:ras]] or
+ * gshare[:bits[:ras]], where bits is log2 of the counter table size and ras
+ * is the return address stack depth; sizes left out take the defaults.
+ * Anything after the last field is an error.
+ *
+ * @param bp Branch predictor to initialize
+ * @param spec Predictor specification string
+ * @returns True if the specification was valid and the tables were allocated
+ */
+bool bpred_init (bpred_t *bp, const char *spec);
+
+/**
+ * @brief Release the tables of a branch predictor
+ *
+ * @param bp Branch predictor to free
+ */
+void bpred_free (bpred_t *bp);
+
+/**
+ * @brief Train the predictor with one executed instruction
+ *
+ * Conditional jumps update the direction predictor, calls push the return
+ * address stack and returns are checked against it; every other instruction
+ * is ignored.
+ *
+ * @param bp Branch predictor to update
+ * @param pc Address of the executed instruction
+ * @param inst Y86 instruction structure for the executed instruction
+ * @param cnd Whether a conditional jump was taken
+ * @param next_pc Address of the instruction executed next
+ */
+void bpred_step (bpred_t *bp, address_t pc, y86_inst_t inst, bool cnd,
+        address_t next_pc);
+
+/**
+ * @brief Print overall and per-branch misprediction statistics to standard out
+ *
+ * @param bp Branch predictor to print
+ */
+void dump_bpred_stats (bpred_t *bp);
+
+#endif
@@ -0,0 +1,322 @@
+/*
+ * CS 261: Cache hierarchy simulator
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "cache.h"
+
+bool cache_setup(cache_t *cache);
+bool cache_parse_level(cache_sim_t *sim, char *entry);
+bool cache_lookup(cache_sim_t *sim, cache_t *cache, address_t addr, bool write,
+        address_t *victim, bool *victim_dirty);
+int cache_fill_l2(cache_sim_t *sim, address_t addr, int len, bool write);
+const char *repl_name(repl_t repl);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool cache_init (cache_sim_t *sim, const char *spec)
+{
+    // check for bad parameters
+    if (sim == NULL || spec == NULL) {
+        return false;
+    }
+
+    memset(sim, 0x00, sizeof(cache_sim_t));
+    sim->seed = 0x2545f4914f6cdd1dULL;
+
+    // default geometry, sized for the small Y86 address space
+    sim->l1i = (cache_t) { .name = "L1I", .size = 512, .assoc = 2, .line = 16 };
+    sim->l1d = (cache_t) { .name = "L1D", .size = 512, .assoc = 2, .line = 16 };
+    sim->l2  = (cache_t) { .name = "L2", .size = 2048, .assoc = 4, .line = 32 };
+
+    // override levels named in the specification
+    if (strcmp(spec, "default") != 0) {
+        char copy[256];
+        if (strlen(spec) >= sizeof(copy)) {
+            return false;
+        }
+        strcpy(copy, spec);
+
+        for (char *entry = strtok(copy, ","); entry != NULL; entry = strtok(NULL, ",")) {
+            if (!cache_parse_level(sim, entry)) {
+                return false;
+            }
+        }
+    }
+
+    sim->pcs = (cache_pc_stats_t*)calloc(MEMSIZE, sizeof(cache_pc_stats_t));
+    if (sim->pcs == NULL || !cache_setup(&sim->l1i) || !cache_setup(&sim->l1d)
+          || !cache_setup(&sim->l2)) {
+        cache_free(sim);
+        return false;
+    }
+
+    return true;
+}
+
+void cache_free (cache_sim_t *sim)
+{
+    cache_t *levels[] = { &sim->l1i, &sim->l1d, &sim->l2 };
+
+    for (int i = 0; i < 3; i++) {
+        free(levels[i]->tags);
+        free(levels[i]->valid);
+        free(levels[i]->dirty);
+        free(levels[i]->stamp);
+    }
+    free(sim->pcs);
+    memset(sim, 0x00, sizeof(cache_sim_t));
+}
+
+void cache_access (void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size)
+{
+    cache_sim_t *sim = (cache_sim_t*)arg;
+    cache_t *l1 = (type == ACCESS_FETCH) ? &sim->l1i : &sim->l1d;
+    bool write = (type == ACCESS_WRITE);
+    cache_pc_stats_t *stats = &sim->pcs[pc % MEMSIZE];
+
+    if (size == 0) {
+        return;
+    }
+
+    // an access that straddles L1 lines touches each of them
+    address_t first = addr / l1->line;
+    address_t last = (addr + size - 1) / l1->line;
+
+    for (address_t line = first; line <= last; line++) {
+        address_t victim;
+        bool victim_dirty;
+
+        if (type != ACCESS_FETCH) {
+            stats->data++;
+        }
+
+        if (cache_lookup(sim, l1, line * l1->line, write, &victim, &victim_dirty)) {
+            continue;
+        }
+
+        if (type == ACCESS_FETCH) {
+            stats->fetch_miss++;
+        } else {
+            stats->data_miss++;
+        }
+
+        // write the evicted line back, then fill from L2
+        if (victim_dirty) {
+            stats->l2_miss += cache_fill_l2(sim, victim, l1->line, true);
+        }
+        stats->l2_miss += cache_fill_l2(sim, line * l1->line, l1->line, false);
+    }
+}
+
+void dump_cache_stats (cache_sim_t *sim)
+{
+    cache_t *levels[] = { &sim->l1i, &sim->l1d, &sim->l2 };
+
+    printf("Cache hierarchy:\n");
+    printf("  Level    Size  Ways  Line  Policy     Accesses        Hits      Misses"
+           "  Miss rate  Write-backs\n");
+    for (int i = 0; i < 3; i++) {
+        cache_t *c = levels[i];
+        uint64_t accesses = c->hits + c->misses;
+        printf("  %-5s  %6d  %4d  %4d  %-6s  %11" PRIu64 " %11" PRIu64 " %11"
+               PRIu64 "   %6.2f%%  %11" PRIu64 "\n",
+                c->name, c->size, c->assoc, c->line, repl_name(c->repl),
+                accesses, c->hits, c->misses,
+                accesses > 0 ? 100.0 * c->misses / accesses : 0.0,
+                c->writebacks);
+    }
+
+    // per-instruction breakdown, in address order
+    printf("  Instruction PC   L1I misses  Data accesses  L1D misses   L2 misses\n");
+    for (int pc = 0; pc < MEMSIZE; pc++) {
+        cache_pc_stats_t *s = &sim->pcs[pc];
+        if (s->fetch_miss == 0 && s->data_miss == 0 && s->l2_miss == 0) {
+            continue;
+        }
+        printf("  0x%04x         %11" PRIu64 "    %11" PRIu64 " %11" PRIu64 " %11" PRIu64 "\n",
+                pc, s->fetch_miss, s->data, s->data_miss, s->l2_miss);
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * check the geometry of one cache level and allocate its tables
+ */
+bool cache_setup(cache_t *cache)
+{
+    // bound line and assoc by the size first, so their product cannot
+    // overflow
+    if (cache->line < 1 || cache->assoc < 1 || cache->line > cache->size
+          || cache->assoc > cache->size / cache->line
+          || cache->size % (cache->line * cache->assoc) != 0) {
+        return false;
+    }
+
+    cache->sets = cache->size / (cache->line * cache->assoc);
+
+    int lines = cache->sets * cache->assoc;
+    cache->tags = (uint64_t*)calloc(lines, sizeof(uint64_t));
+    cache->valid = (bool*)calloc(lines, sizeof(bool));
+    cache->dirty = (bool*)calloc(lines, sizeof(bool));
+    cache->stamp = (uint64_t*)calloc(lines, sizeof(uint64_t));
+
+    return cache->tags != NULL && cache->valid != NULL && cache->dirty != NULL
+        && cache->stamp != NULL;
+}
+
+/**
+ * parse one level=size:assoc:line[:policy] entry of a cache specification
+ */
+bool cache_parse_level(cache_sim_t *sim, char *entry)
+{
+    char name[8];
+    char policy[8] = "lru";
+    int size;
+    int assoc;
+    int line;
+    cache_t *cache;
+
+    // note where the geometry and the policy ended, so nothing may follow
+    // the last field
+    int ends[2] = { 0, 0 };
+    int fields = sscanf(entry, "%7[a-z0-9]=%d:%d:%d%n:%7[a-z]%n", name, &size,
+            &assoc, &line, &ends[0], policy, &ends[1]);
+    if (fields < 4 || entry[ends[fields - 4]] != '\0') {
+        return false;
+    }
+
+    if (strcmp(name, "l1i") == 0) {
+        cache = &sim->l1i;
+    } else if (strcmp(name, "l1d") == 0) {
+        cache = &sim->l1d;
+    } else if (strcmp(name, "l2") == 0) {
+        cache = &sim->l2;
+    } else {
+        return false;
+    }
+
+    if (strcmp(policy, "lru") == 0) {
+        cache->repl = REPL_LRU;
+    } else if (strcmp(policy, "fifo") == 0) {
+        cache->repl = REPL_FIFO;
+    } else if (strcmp(policy, "random") == 0) {
+        cache->repl = REPL_RANDOM;
+    } else {
+        return false;
+    }
+
+    cache->size = size;
+    cache->assoc = assoc;
+    cache->line = line;
+
+    return true;
+}
+
+/**
+ * look up (and on a miss, allocate) the line holding addr; reports the line
+ * that was evicted to make room and whether it held modified data
+ */
+bool cache_lookup(cache_sim_t *sim, cache_t *cache, address_t addr, bool write,
+        address_t *victim, bool *victim_dirty)
+{
+    uint64_t tag = addr / cache->line;
+    int base = (tag % cache->sets) * cache->assoc;
+    int slot = -1;
+
+    sim->clock++;
+    *victim_dirty = false;
+
+    // hit: refresh the LRU stamp
+    for (int i = base; i < base + cache->assoc; i++) {
+        if (cache->valid[i] && cache->tags[i] == tag) {
+            if (cache->repl == REPL_LRU) {
+                cache->stamp[i] = sim->clock;
+            }
+            cache->dirty[i] |= write;
+            cache->hits++;
+            return true;
+        }
+    }
+
+    cache->misses++;
+
+    // miss: prefer an invalid way, otherwise pick a victim
+    for (int i = base; i < base + cache->assoc; i++) {
+        if (!cache->valid[i]) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0 && cache->repl == REPL_RANDOM) {
+        sim->seed ^= sim->seed << 13;
+        sim->seed ^= sim->seed >> 7;
+        sim->seed ^= sim->seed << 17;
+        slot = base + sim->seed % cache->assoc;
+    } else if (slot < 0) {
+        // LRU and FIFO both evict the oldest stamp
+        slot = base;
+        for (int i = base + 1; i < base + cache->assoc; i++) {
+            if (cache->stamp[i] < cache->stamp[slot]) {
+                slot = i;
+            }
+        }
+    }
+
+    if (cache->valid[slot] && cache->dirty[slot]) {
+        *victim = cache->tags[slot] * cache->line;
+        *victim_dirty = true;
+        cache->writebacks++;
+    }
+
+    cache->tags[slot] = tag;
+    cache->valid[slot] = true;
+    cache->dirty[slot] = write;
+    cache->stamp[slot] = sim->clock;
+
+    return false;
+}
+
+/**
+ * service an L1 miss or write-back of the len-byte line at addr from the
+ * unified L2, touching every L2 line it covers (an L2 line may be smaller
+ * than an L1 line); dirty L2 victims go to memory and are only counted.
+ * Returns the number of L2 misses.
+ */
+int cache_fill_l2(cache_sim_t *sim, address_t addr, int len, bool write)
+{
+    address_t victim;
+    bool victim_dirty;
+    int misses = 0;
+
+    address_t first = addr / sim->l2.line;
+    address_t last = (addr + len - 1) / sim->l2.line;
+    for (address_t line = first; line <= last; line++) {
+        if (!cache_lookup(sim, &sim->l2, line * sim->l2.line, write, &victim,
+                    &victim_dirty)) {
+            misses++;
+        }
+    }
+    return misses;
+}
+
+/**
+ * get the printable name of a replacement policy
+ */
+const char *repl_name(repl_t repl)
+{
+    switch (repl) {
+        case REPL_LRU:    return "LRU";
+        case REPL_FIFO:   return "FIFO";
+        case REPL_RANDOM: return "random";
+    }
+
+    return "?";
+}
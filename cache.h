@@ -0,0 +1,105 @@
+#ifndef __CS261_CACHE__
+#define __CS261_CACHE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memhook.h"
+#include "y86.h"
+
+/* replacement policies */
+typedef enum {
+    REPL_LRU = 0, REPL_FIFO, REPL_RANDOM
+} repl_t;
+
+/* one level of set-associative, write-back, write-allocate cache */
+typedef struct cache {
+
+    const char *name;           // level name used in reports
+    int size;                   // capacity in bytes
+    int assoc;                  // lines per set
+    int line;                   // line size in bytes
+    repl_t repl;                // replacement policy
+    int sets;                   // number of sets
+
+    uint64_t *tags;             // tag per line (line address)
+    bool *valid;                // valid bit per line
+    bool *dirty;                // dirty bit per line
+    uint64_t *stamp;            // last use (LRU) or fill (FIFO) time per line
+
+    uint64_t hits;              // accesses that hit
+    uint64_t misses;            // accesses that missed
+    uint64_t writebacks;        // dirty lines evicted
+
+} cache_t;
+
+/* per-instruction miss counters */
+typedef struct cache_pc_stats {
+
+    uint64_t fetch_miss;        // L1I misses fetching this instruction
+    uint64_t data;              // data accesses made by this instruction
+    uint64_t data_miss;         // L1D misses for those accesses
+    uint64_t l2_miss;           // L2 misses caused by this instruction
+
+} cache_pc_stats_t;
+
+/* split L1 instruction/data caches backed by a unified L2 */
+typedef struct cache_sim {
+
+    cache_t l1i;
+    cache_t l1d;
+    cache_t l2;
+
+    uint64_t clock;             // access counter used for LRU/FIFO stamps
+    uint64_t seed;              // state of the random replacement generator
+
+    cache_pc_stats_t *pcs;      // per-PC statistics, indexed by address
+
+} cache_sim_t;
+
+/**
+ * @brief Set up a cache hierarchy from a command-line specification
+ *
+ * The specification is "default" or a comma-separated list of
+ * level=size:assoc:line[:policy] entries, where level is l1i, l1d or l2 and
+ * policy is lru, fifo or random. Levels that are not listed keep their
+ * default geometry.
+ *
+ * @param sim Cache hierarchy to initialize
+ * @param spec Cache specification string
+ * @returns True if the specification was valid and the caches were allocated
+ */
+bool cache_init (cache_sim_t *sim, const char *spec);
+
+/**
+ * @brief Release the tables of a cache hierarchy
+ *
+ * @param sim Cache hierarchy to free
+ */
+void cache_free (cache_sim_t *sim);
+
+/**
+ * @brief Guest memory access hook that drives the cache hierarchy
+ *
+ * Install with set_mem_hook(cache_access, sim).
+ *
+ * @param arg Pointer to the cache_sim_t to update
+ * @param type Kind of access
+ * @param pc Address of the instruction making the access
+ * @param addr First guest address accessed
+ * @param size Number of bytes accessed
+ */
+void cache_access (void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size);
+
+/**
+ * @brief Print hit/miss rates per level and per PC to standard out
+ *
+ * @param sim Cache hierarchy to print
+ */
+void dump_cache_stats (cache_sim_t *sim);
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ * CS 261: Checkpoint and restore
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "checkpoint.h"
+
+void put_le(byte_t *out, uint64_t v, int bytes);
+uint64_t get_le(const byte_t *in, int bytes);
+uint64_t fnv1a(const byte_t *data, size_t len);
+bool page_is_zero(byte_t *page);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+size_t checkpoint_encode (machine_t *m, byte_t *out)
+{
+    byte_t *p = out;
+    byte_t *bitmap;
+    uint32_t stored = 0;
+
+    // header (the page count is filled in below)
+    memcpy(p, CKPT_MAGIC, 4);
+    put_le(p + 4, CKPT_VERSION, 2);
+    put_le(p + 6, CKPT_PAGE_SIZE, 2);
+    put_le(p + 12, m->count, 8);
+    p += CKPT_HEADER_SIZE;
+
+    // cpu
+    for (int i = 0; i < NUMREGS; i++) {
+        put_le(p + 8 * i, m->cpu.reg[i], 8);
+    }
+    put_le(p + 8 * NUMREGS, m->cpu.pc, 8);
+    p += 8 * (NUMREGS + 1);
+    memset(p, 0x00, 8);
+    p[0] = m->cpu.zf;
+    p[1] = m->cpu.sf;
+    p[2] = m->cpu.of;
+    p[3] = m->cpu.stat;
+    p += 8;
+
+    // I/O trap buffer
+    memcpy(p, buffer, IOBUF_SIZE);
+    p += IOBUF_SIZE;
+
+    // page bitmap, then every page that holds anything
+    bitmap = p;
+    memset(bitmap, 0x00, CKPT_PAGES / 8);
+    p += CKPT_PAGES / 8;
+    for (int i = 0; i < CKPT_PAGES; i++) {
+        byte_t *page = &m->memory[i * CKPT_PAGE_SIZE];
+        if (!page_is_zero(page)) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            memcpy(p, page, CKPT_PAGE_SIZE);
+            p += CKPT_PAGE_SIZE;
+            stored++;
+        }
+    }
+    put_le(out + 8, stored, 4);
+
+    put_le(p, fnv1a(out, p - out), 8);
+    p += 8;
+
+    return p - out;
+}
+
+bool checkpoint_decode (machine_t *m, const byte_t *buf, size_t len)
+{
+    // check the framing before touching the machine
+    if (buf == NULL || len < CKPT_FIXED_SIZE || memcmp(buf, CKPT_MAGIC, 4) != 0
+          || get_le(buf + 4, 2) != CKPT_VERSION
+          || get_le(buf + 6, 2) != CKPT_PAGE_SIZE) {
+        return false;
+    }
+    uint32_t stored = get_le(buf + 8, 4);
+    if (stored > CKPT_PAGES || len != CKPT_FIXED_SIZE + stored * CKPT_PAGE_SIZE) {
+        return false;
+    }
+    if (get_le(buf + len - 8, 8) != fnv1a(buf, len - 8)) {
+        return false;
+    }
+
+    const byte_t *cpu = buf + CKPT_HEADER_SIZE;
+    const byte_t *flags = cpu + 8 * (NUMREGS + 1);
+    const byte_t *iobuf = cpu + CKPT_CPU_SIZE;
+    const byte_t *bitmap = iobuf + IOBUF_SIZE;
+    const byte_t *page = bitmap + CKPT_PAGES / 8;
+
+    // the bitmap must agree with the page count
+    uint32_t marked = 0;
+    for (int i = 0; i < CKPT_PAGES; i++) {
+        marked += (bitmap[i / 8] >> (i % 8)) & 1;
+    }
+    if (marked != stored || flags[3] < AOK || flags[3] > INS) {
+        return false;
+    }
+
+    memset(&m->cpu, 0x00, sizeof(y86_t));
+    for (int i = 0; i < NUMREGS; i++) {
+        m->cpu.reg[i] = get_le(cpu + 8 * i, 8);
+    }
+    m->cpu.pc = get_le(cpu + 8 * NUMREGS, 8);
+    m->cpu.zf = flags[0];
+    m->cpu.sf = flags[1];
+    m->cpu.of = flags[2];
+    m->cpu.stat = flags[3];
+    m->count = get_le(buf + 12, 8);
+
+    memcpy(buffer, iobuf, IOBUF_SIZE);
+
+    for (int i = 0; i < CKPT_PAGES; i++) {
+        byte_t *dest = &m->memory[i * CKPT_PAGE_SIZE];
+        if ((bitmap[i / 8] >> (i % 8)) & 1) {
+            memcpy(dest, page, CKPT_PAGE_SIZE);
+            page += CKPT_PAGE_SIZE;
+        } else {
+            memset(dest, 0x00, CKPT_PAGE_SIZE);
+        }
+    }
+
+    // a restored machine continues like a fresh run from this state; all of
+    // memory may now differ from the loaded image
+    machine_mark_dirty(m, 0, MEMSIZE);
+    m->stop = STOP_NONE;
+    m->started = false;
+    m->block_insts = 0;
+    if (m->loop != NULL) {
+        loopdet_reset(m->loop, m->memory);
+    }
+    if (m->journal != NULL) {
+        journal_reset(m->journal, m->count);
+    }
+
+    return true;
+}
+
+bool checkpoint_save (machine_t *m, const char *filename)
+{
+    byte_t out[CKPT_MAX_SIZE];
+    size_t len = checkpoint_encode(m, out);
+
+    // write beside the target and rename, so a crash never leaves half a file
+    size_t namelen = strlen(filename) + 5;
+    char *tmp = (char*)malloc(namelen);
+    if (tmp == NULL) {
+        return false;
+    }
+    snprintf(tmp, namelen, "%s.tmp", filename);
+
+    FILE *file = fopen(tmp, "wb");
+    if (file == NULL) {
+        free(tmp);
+        return false;
+    }
+    bool ok = fwrite(out, 1, len, file) == len;
+    ok = (fclose(file) == 0) && ok;
+    ok = ok && rename(tmp, filename) == 0;
+    if (!ok) {
+        remove(tmp);
+    }
+    free(tmp);
+
+    return ok;
+}
+
+bool checkpoint_restore (machine_t *m, const char *filename)
+{
+    byte_t in[CKPT_MAX_SIZE + 1];
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // the whole file is read in one go; anything longer than a full
+    // checkpoint is rejected by the length check
+    size_t len = fread(in, 1, sizeof(in), file);
+    fclose(file);
+
+    return checkpoint_decode(m, in, len);
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * store an integer little-endian
+ */
+void put_le(byte_t *out, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (v >> (8 * i)) & 0xff;
+    }
+}
+
+/**
+ * load a little-endian integer
+ */
+uint64_t get_le(const byte_t *in, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | in[i];
+    }
+    return v;
+}
+
+/**
+ * 64-bit FNV-1a hash
+ */
+uint64_t fnv1a(const byte_t *data, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * check whether a memory page holds only zero bytes
+ */
+bool page_is_zero(byte_t *page)
+{
+    uint64_t acc = 0;
+    for (int i = 0; i < CKPT_PAGE_SIZE; i += 8) {
+        uint64_t word;
+        memcpy(&word, page + i, 8);
+        acc |= word;
+    }
+    return acc == 0;
+}
@@ -0,0 +1,76 @@
+#ifndef __CS261_CHECKPOINT__
+#define __CS261_CHECKPOINT__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "p4-interp.h"
+#include "y86.h"
+
+/* checkpoint file format:
+
+     header     magic "Y86K", u16 version, u16 page size, u32 pages stored,
+                u64 instruction count
+     cpu        u64 registers[15], u64 pc, u8 zf, sf, of, stat, 4 bytes padding
+     iobuf      I/O trap output buffer (IOBUF_SIZE bytes)
+     bitmap     one bit per memory page, set if the page is stored
+     pages      contents of each stored page, in address order
+     checksum   u64 FNV-1a hash of everything above
+
+   All integers are little-endian. Pages that are entirely zero are not
+   stored. */
+#define CKPT_MAGIC "Y86K"
+#define CKPT_VERSION 1
+#define CKPT_PAGE_SIZE 256
+#define CKPT_PAGES (MEMSIZE / CKPT_PAGE_SIZE)
+#define CKPT_HEADER_SIZE 20
+#define CKPT_CPU_SIZE ((NUMREGS + 1) * 8 + 8)
+#define CKPT_FIXED_SIZE (CKPT_HEADER_SIZE + CKPT_CPU_SIZE + IOBUF_SIZE \
+        + CKPT_PAGES / 8 + 8)
+#define CKPT_MAX_SIZE (CKPT_FIXED_SIZE + MEMSIZE)
+
+/**
+ * @brief Encode the execution state of a machine as a checkpoint
+ *
+ * @param m Machine to save
+ * @param out Buffer of at least CKPT_MAX_SIZE bytes
+ * @returns Number of bytes written to the buffer
+ */
+size_t checkpoint_encode (machine_t *m, byte_t *out);
+
+/**
+ * @brief Replace the execution state of a machine with a checkpoint
+ *
+ * The loaded image (used by machine_reset) is kept; the CPU, memory,
+ * instruction count and I/O buffer come from the checkpoint.
+ *
+ * @param m Machine to restore into
+ * @param buf Checkpoint bytes
+ * @param len Length of the checkpoint in bytes
+ * @returns True if the checkpoint was valid; the machine is unchanged if not
+ */
+bool checkpoint_decode (machine_t *m, const byte_t *buf, size_t len);
+
+/**
+ * @brief Write a checkpoint file, replacing any previous one atomically
+ *
+ * @param m Machine to save
+ * @param filename Path of the checkpoint file
+ * @returns True if the file was written
+ */
+bool checkpoint_save (machine_t *m, const char *filename);
+
+/**
+ * @brief Restore a machine from a checkpoint file
+ *
+ * @param m Machine to restore into
+ * @param filename Path of the checkpoint file
+ * @returns True if the file was read and valid
+ */
+bool checkpoint_restore (machine_t *m, const char *filename);
+
+#endif
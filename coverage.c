@@ -0,0 +1,188 @@
+/*
+ * CS 261: Code coverage
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "coverage.h"
+
+int coverage_count(uint64_t *bits, address_t start, address_t end);
+void coverage_line(coverage_t *c, uint64_t *starts, uint64_t *branches,
+        address_t start, address_t end);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool coverage_merge_file (coverage_t *c, const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // check the header, then read all three bitmaps before merging any
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    coverage_t saved;
+    bool ok = fread(magic, 1, 4, file) == 4
+        && memcmp(magic, COVERAGE_MAGIC, 4) == 0
+        && fread(&version, 2, 1, file) == 1 && version == COVERAGE_VERSION
+        && fread(&reserved, 2, 1, file) == 1
+        && fread(&saved, sizeof(coverage_t), 1, file) == 1;
+    fclose(file);
+
+    if (!ok) {
+        return false;
+    }
+    for (int i = 0; i < COVERAGE_WORDS; i++) {
+        c->exec[i] |= saved.exec[i];
+        c->taken[i] |= saved.taken[i];
+        c->not_taken[i] |= saved.not_taken[i];
+    }
+
+    return true;
+}
+
+bool coverage_save (coverage_t *c, const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint16_t version = COVERAGE_VERSION;
+    uint16_t reserved = 0;
+    bool ok = fwrite(COVERAGE_MAGIC, 1, 4, file) == 4
+        && fwrite(&version, 2, 1, file) == 1
+        && fwrite(&reserved, 2, 1, file) == 1
+        && fwrite(c, sizeof(coverage_t), 1, file) == 1;
+
+    return (fclose(file) == 0) && ok;
+}
+
+void dump_coverage (coverage_t *c, elf_hdr_t *hdr, elf_phdr_t *phdrs,
+        byte_t *image, symtab_t *symbols)
+{
+    uint64_t starts[COVERAGE_WORDS];
+    uint64_t branches[COVERAGE_WORDS];
+    memset(starts, 0x00, sizeof(starts));
+    memset(branches, 0x00, sizeof(branches));
+
+    // decode each code segment from its start with fetch(), stepping one
+    // byte past anything that is not an instruction; the access hook is
+    // cleared so the decoding is not traced
+    mem_hook_t hook = mem_hook;
+    void *arg = mem_hook_arg;
+    set_mem_hook(NULL, NULL);
+    for (int i = 0; i < hdr->e_num_phdr; i++) {
+        if (phdrs[i].p_type != CODE) {
+            continue;
+        }
+        address_t end = (address_t) phdrs[i].p_vaddr + phdrs[i].p_filesz;
+        if (end > MEMSIZE) {
+            end = MEMSIZE;
+        }
+        for (address_t a = phdrs[i].p_vaddr; a < end; ) {
+            y86_t cpu;
+            memset(&cpu, 0x00, sizeof(y86_t));
+            cpu.stat = AOK;
+            cpu.pc = a;
+            y86_inst_t inst = fetch(&cpu, image);
+            if (cpu.stat != AOK || inst.valP > end) {
+                a++;
+                continue;
+            }
+            starts[a >> 6] |= 1ULL << (a & 63);
+            if (inst.icode == JUMP && inst.ifun.jump != JMP) {
+                branches[a >> 6] |= 1ULL << (a & 63);
+            }
+            a = inst.valP;
+        }
+    }
+    set_mem_hook(hook, arg);
+
+    // whatever actually ran was an instruction, even if decoding missed it
+    for (int i = 0; i < COVERAGE_WORDS; i++) {
+        starts[i] |= c->exec[i];
+        branches[i] |= c->taken[i] | c->not_taken[i];
+    }
+
+    printf("Coverage:\n");
+    printf("  %-24s %-9s  %-19s   %s\n", "Segment or symbol", "Addresses",
+            "Instructions", "Branch directions");
+    for (int i = 0; i < hdr->e_num_phdr; i++) {
+        if (phdrs[i].p_type != CODE) {
+            continue;
+        }
+        address_t start = phdrs[i].p_vaddr;
+        address_t end = start + phdrs[i].p_filesz;
+        if (end > MEMSIZE) {
+            end = MEMSIZE;
+        }
+        if (start >= end) {
+            continue;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "segment %d", i);
+        printf("  %-24s %04lx-%04lx  ", name, start, end - 1);
+        coverage_line(c, starts, branches, start, end);
+
+        // each symbol in the segment runs up to the next one
+        for (int s = 0; s < symbols->count; s++) {
+            address_t from = symbols->syms[s].addr;
+            if (from < start || from >= end
+                  || (s > 0 && symbols->syms[s - 1].addr == from)) {
+                continue;
+            }
+            address_t to = end;
+            for (int n = s + 1; n < symbols->count; n++) {
+                if (symbols->syms[n].addr > from) {
+                    to = symbols->syms[n].addr < end ? symbols->syms[n].addr : end;
+                    break;
+                }
+            }
+            printf("    %-22.22s %04lx-%04lx  ", symbols->syms[s].name, from, to - 1);
+            coverage_line(c, starts, branches, from, to);
+        }
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * number of bits set for addresses start to end - 1
+ */
+int coverage_count(uint64_t *bits, address_t start, address_t end)
+{
+    int count = 0;
+
+    for (address_t a = start; a < end; a++) {
+        count += (bits[a >> 6] >> (a & 63)) & 1;
+    }
+    return count;
+}
+
+/**
+ * print the instruction and branch-direction coverage of one address range
+ */
+void coverage_line(coverage_t *c, uint64_t *starts, uint64_t *branches,
+        address_t start, address_t end)
+{
+    int insts = coverage_count(starts, start, end);
+    int run = coverage_count(c->exec, start, end);
+    int dirs = 2 * coverage_count(branches, start, end);
+    int seen = coverage_count(c->taken, start, end)
+        + coverage_count(c->not_taken, start, end);
+
+    printf("%5d/%-5d %6.1f%%", run, insts, insts > 0 ? 100.0 * run / insts : 0.0);
+    if (dirs > 0) {
+        printf("   %5d/%-5d %6.1f%%\n", seen, dirs, 100.0 * seen / dirs);
+    } else {
+        printf("   %5s\n", "-");
+    }
+}
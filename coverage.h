@@ -0,0 +1,102 @@
+#ifndef __CS261_COVERAGE__
+#define __CS261_COVERAGE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elf.h"
+#include "memhook.h"
+#include "p3-disas.h"
+#include "symtab.h"
+#include "y86.h"
+
+/* coverage file format:
+
+     header     magic "Y86C", u16 version, u16 reserved (zero)
+     executed   MEMSIZE bits, one per address an instruction started at
+     taken      MEMSIZE bits, one per conditional jump seen taken
+     not taken  MEMSIZE bits, one per conditional jump seen falling through
+
+   Each bitmap is an array of little-endian 64-bit words; address a is bit
+   a % 64 of word a / 64. Files from different runs merge by OR. */
+#define COVERAGE_MAGIC "Y86C"
+#define COVERAGE_VERSION 1
+#define COVERAGE_HEADER_SIZE 8
+
+/* 64-bit words in each bitmap */
+#define COVERAGE_WORDS (MEMSIZE / 64)
+
+/* code reached by one or more runs */
+typedef struct coverage {
+
+    uint64_t exec[COVERAGE_WORDS];      // instruction starts executed
+    uint64_t taken[COVERAGE_WORDS];     // conditional jumps that jumped
+    uint64_t not_taken[COVERAGE_WORDS]; // conditional jumps that fell through
+
+} coverage_t;
+
+/**
+ * @brief Record one executed instruction
+ *
+ * Cheap enough for the uninstrumented run loop: one OR, plus one more for a
+ * conditional jump.
+ *
+ * @param c Coverage to update
+ * @param pc Address the instruction was fetched from (below MEMSIZE)
+ * @param inst The instruction
+ * @param cnd Whether a conditional jump was taken
+ */
+static inline void coverage_mark (coverage_t *c, address_t pc,
+        y86_inst_t *inst, bool cnd)
+{
+    uint64_t bit = 1ULL << (pc & 63);
+
+    c->exec[pc >> 6] |= bit;
+    if (inst->icode == JUMP && inst->ifun.jump != JMP) {
+        if (cnd) {
+            c->taken[pc >> 6] |= bit;
+        } else {
+            c->not_taken[pc >> 6] |= bit;
+        }
+    }
+}
+
+/**
+ * @brief OR the coverage saved in a file into c
+ *
+ * @param c Coverage to add to
+ * @param filename Coverage file to read
+ * @returns False if the file is missing or is not a coverage file
+ */
+bool coverage_merge_file (coverage_t *c, const char *filename);
+
+/**
+ * @brief Write coverage to a file
+ *
+ * @param c Coverage to save
+ * @param filename File to create or replace
+ * @returns False if the file could not be written
+ */
+bool coverage_save (coverage_t *c, const char *filename);
+
+/**
+ * @brief Print instruction and branch coverage per code segment and per
+ * symbol in a code segment
+ *
+ * The instructions of a segment are found by decoding it from its start with
+ * fetch(), so the totals also count code no run reached; instruction starts
+ * that only a run found are added to them.
+ *
+ * @param c Coverage to report
+ * @param hdr Header of the image
+ * @param phdrs Program headers of the image
+ * @param image Guest memory as loaded
+ * @param symbols Symbols of the image (may be empty)
+ */
+void dump_coverage (coverage_t *c, elf_hdr_t *hdr, elf_phdr_t *phdrs,
+        byte_t *image, symtab_t *symbols);
+
+#endif
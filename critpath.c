@@ -0,0 +1,210 @@
+/*
+ * CS 261: Dataflow critical-path analyzer
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "critpath.h"
+
+/* words tracked for memory dependences */
+#define MEM_WORDS (MEMSIZE / 8 + 2)
+
+void chain_release(critpath_t *cp, chain_node_t *node);
+void chain_assign(critpath_t *cp, chain_node_t **slot, chain_node_t *node);
+chain_node_t *chain_later(chain_node_t *a, chain_node_t *b);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool critpath_init (critpath_t *cp)
+{
+    // check for bad parameters
+    if (cp == NULL) {
+        return false;
+    }
+
+    memset(cp, 0x00, sizeof(critpath_t));
+    cp->mem = (chain_node_t**)calloc(MEM_WORDS, sizeof(chain_node_t*));
+
+    return cp->mem != NULL;
+}
+
+void critpath_free (critpath_t *cp)
+{
+    // drop every reference so the whole graph lands on the free list
+    for (int i = 0; i < NUMREGS; i++) {
+        chain_assign(cp, &cp->reg[i], NULL);
+    }
+    chain_assign(cp, &cp->flags, NULL);
+    for (int i = 0; cp->mem != NULL && i < MEM_WORDS; i++) {
+        chain_assign(cp, &cp->mem[i], NULL);
+    }
+    chain_assign(cp, &cp->longest, NULL);
+
+    while (cp->free_list != NULL) {
+        chain_node_t *next = cp->free_list->parent;
+        free(cp->free_list);
+        cp->free_list = next;
+    }
+
+    free(cp->mem);
+    memset(cp, 0x00, sizeof(critpath_t));
+}
+
+void critpath_step (critpath_t *cp, address_t pc, y86_inst_t inst, bool cnd,
+        y86_reg_t valA, y86_reg_t valE)
+{
+    inst_deps_t deps;
+    chain_node_t *parent = NULL;
+    chain_node_t *node;
+    uint64_t word = 0;
+
+    get_deps(inst, cnd, valA, valE, &deps);
+    if (deps.mem_read || deps.mem_write) {
+        word = (deps.mem_addr % MEMSIZE) / 8;
+    }
+
+    // the instruction can start once its last input has been produced
+    for (int i = 0; i < MAX_SRCS; i++) {
+        if (deps.src[i] != NOREG) {
+            parent = chain_later(parent, cp->reg[deps.src[i]]);
+        }
+    }
+    if (deps.reads_flags) {
+        parent = chain_later(parent, cp->flags);
+    }
+    if (deps.mem_read) {
+        parent = chain_later(parent, cp->mem[word]);
+        if (deps.mem_addr % 8 != 0) {
+            parent = chain_later(parent, cp->mem[word + 1]);
+        }
+    }
+
+    // reuse a recycled node if there is one
+    if (cp->free_list != NULL) {
+        node = cp->free_list;
+        cp->free_list = node->parent;
+    } else {
+        node = (chain_node_t*)malloc(sizeof(chain_node_t));
+        if (node == NULL) {
+            cp->insts++;
+            return;
+        }
+    }
+
+    node->pc = pc;
+    node->index = cp->insts;
+    node->time = (parent != NULL) ? parent->time + 1 : 1;
+    node->parent = parent;
+    node->refs = 1;
+    if (parent != NULL) {
+        parent->refs++;
+    }
+
+    // every value the instruction wrote now becomes available at node->time
+    for (int i = 0; i < MAX_DSTS; i++) {
+        if (deps.dst[i] != NOREG) {
+            chain_assign(cp, &cp->reg[deps.dst[i]], node);
+        }
+    }
+    if (deps.writes_flags) {
+        chain_assign(cp, &cp->flags, node);
+    }
+    if (deps.mem_write) {
+        chain_assign(cp, &cp->mem[word], node);
+        if (deps.mem_addr % 8 != 0) {
+            chain_assign(cp, &cp->mem[word + 1], node);
+        }
+    }
+
+    if (node->time > cp->length) {
+        cp->length = node->time;
+        chain_assign(cp, &cp->longest, node);
+    }
+
+    chain_release(cp, node);
+    cp->insts++;
+}
+
+void dump_critpath_stats (critpath_t *cp)
+{
+    chain_node_t *tail[CHAIN_TAIL];
+    int tail_len = 0;
+    uint64_t *counts = (uint64_t*)calloc(MEMSIZE, sizeof(uint64_t));
+
+    printf("Dataflow critical path:\n");
+    printf("  Instructions: %" PRIu64 "   Critical path: %" PRIu64 "   Ideal IPC: %.3f\n",
+            cp->insts, cp->length,
+            cp->length > 0 ? (double) cp->insts / cp->length : 0.0);
+
+    if (counts == NULL || cp->longest == NULL) {
+        free(counts);
+        return;
+    }
+
+    // walk the longest chain backwards from its last instruction
+    for (chain_node_t *n = cp->longest; n != NULL; n = n->parent) {
+        counts[n->pc % MEMSIZE]++;
+        if (tail_len < CHAIN_TAIL) {
+            tail[tail_len++] = n;
+        }
+    }
+
+    printf("  Instructions on the longest chain:\n");
+    printf("    Instruction PC   Links\n");
+    for (int pc = 0; pc < MEMSIZE; pc++) {
+        if (counts[pc] > 0) {
+            printf("    0x%04x      %10" PRIu64 "\n", pc, counts[pc]);
+        }
+    }
+
+    printf("  End of the longest chain (instruction number, PC):\n");
+    for (int i = tail_len - 1; i >= 0; i--) {
+        printf("    #%-12" PRIu64 " 0x%04lx\n", tail[i]->index, tail[i]->pc);
+    }
+
+    free(counts);
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * drop one reference to a node, recycling it (and any ancestors that become
+ * unreferenced) onto the free list
+ */
+void chain_release(critpath_t *cp, chain_node_t *node)
+{
+    while (node != NULL && --node->refs == 0) {
+        chain_node_t *parent = node->parent;
+        node->parent = cp->free_list;
+        cp->free_list = node;
+        node = parent;
+    }
+}
+
+/**
+ * point a value slot at a new producer node
+ */
+void chain_assign(critpath_t *cp, chain_node_t **slot, chain_node_t *node)
+{
+    if (node != NULL) {
+        node->refs++;
+    }
+    chain_release(cp, *slot);
+    *slot = node;
+}
+
+/**
+ * pick whichever producer finished later
+ */
+chain_node_t *chain_later(chain_node_t *a, chain_node_t *b)
+{
+    if (a == NULL || (b != NULL && b->time > a->time)) {
+        return b;
+    }
+
+    return a;
+}
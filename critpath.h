@@ -0,0 +1,78 @@
+#ifndef __CS261_CRITPATH__
+#define __CS261_CRITPATH__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deps.h"
+#include "y86.h"
+
+/* number of links printed from the end of the longest chain */
+#define CHAIN_TAIL 16
+
+/* one dynamic instruction on a dependence chain; nodes are shared by every
+   value they produced and freed once nothing refers to them */
+typedef struct chain_node {
+
+    address_t pc;               // address of the instruction
+    uint64_t index;             // dynamic instruction number
+    uint64_t time;              // dataflow time its results became available
+    struct chain_node *parent;  // producer of its latest-arriving input
+    uint32_t refs;              // values, children and tracker references
+
+} chain_node_t;
+
+/* streaming dataflow critical-path analyzer */
+typedef struct critpath {
+
+    uint64_t insts;             // instructions analyzed
+    uint64_t length;            // longest dependence chain so far
+
+    chain_node_t *reg[NUMREGS]; // producer of each register
+    chain_node_t *flags;        // producer of the condition flags
+    chain_node_t **mem;         // producer of each memory word
+    chain_node_t *longest;      // last node of the longest chain
+
+    chain_node_t *free_list;    // recycled nodes
+
+} critpath_t;
+
+/**
+ * @brief Set up an empty critical-path analyzer
+ *
+ * @param cp Analyzer to initialize
+ * @returns True if the analyzer tables were allocated
+ */
+bool critpath_init (critpath_t *cp);
+
+/**
+ * @brief Release every node and table of a critical-path analyzer
+ *
+ * @param cp Analyzer to free
+ */
+void critpath_free (critpath_t *cp);
+
+/**
+ * @brief Add one executed instruction to the dataflow graph
+ *
+ * @param cp Analyzer to update
+ * @param pc Address of the executed instruction
+ * @param inst Y86 instruction structure for the executed instruction
+ * @param cnd Condition computed in the execute phase (jumps and moves)
+ * @param valA Value of valA passed to the memory stage
+ * @param valE Value of valE passed to the memory stage
+ */
+void critpath_step (critpath_t *cp, address_t pc, y86_inst_t inst, bool cnd,
+        y86_reg_t valA, y86_reg_t valE);
+
+/**
+ * @brief Print critical path length, ideal IPC and the longest chain
+ *
+ * @param cp Analyzer to print
+ */
+void dump_critpath_stats (critpath_t *cp);
+
+#endif
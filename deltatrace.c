@@ -0,0 +1,164 @@
+/*
+ * CS 261: Compact (delta-only) trace
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "deltatrace.h"
+
+/* register names as the disassembler prints them */
+const char *DELTA_REG_NAMES[] = {
+    "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14"
+};
+
+/* CPU status names, indexed by y86_stat_t */
+const char *DELTA_STAT_NAMES[] = { "", "AOK", "HLT", "ADR", "INS" };
+
+void deltatrace_print(deltatrace_t *d, y86_t *after);
+void deltatrace_text(deltatrace_t *d, y86_inst_t *inst);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool deltatrace_open (deltatrace_t *d)
+{
+    memset(d, 0x00, sizeof(deltatrace_t));
+
+    // leave room for the terminator fmemopen does not always write
+    d->text_file = fmemopen(d->text, DELTA_TEXT_SIZE - 1, "w");
+    return d->text_file != NULL;
+}
+
+void deltatrace_close (deltatrace_t *d, machine_t *m)
+{
+    deltatrace_flush(d, m);
+    if (d->text_file != NULL) {
+        fclose(d->text_file);
+        d->text_file = NULL;
+    }
+}
+
+void deltatrace_fetch (deltatrace_t *d, machine_t *m, y86_inst_t *inst,
+        bool traced)
+{
+    // the machine only fetches after an instruction that left the CPU AOK,
+    // whatever this fetch did to the status
+    y86_t after = m->cpu;
+    after.stat = AOK;
+    deltatrace_print(d, &after);
+
+    if (!traced) {
+        return;
+    }
+
+    // the full state once, as the base the changes apply to
+    if (d->lines == 0) {
+        dump_cpu_state(after);
+        printf("\n");
+    }
+    d->lines++;
+
+    if (m->cpu.stat != AOK) {
+        printf("%04lx: invalid instruction\n", m->cpu.pc);
+        return;
+    }
+
+    d->pending = true;
+    d->pc = m->cpu.pc;
+    d->before = m->cpu;
+    d->nstores = 0;
+    deltatrace_text(d, inst);
+}
+
+void deltatrace_store (void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size)
+{
+    deltatrace_t *d = (deltatrace_t*)arg;
+
+    if (!d->pending || d->nstores == DELTA_MAX_STORES) {
+        return;
+    }
+
+    d->stores[d->nstores++] = (delta_store_t) {
+        .addr = addr, .old = old, .val = val, .size = size
+    };
+}
+
+void deltatrace_flush (deltatrace_t *d, machine_t *m)
+{
+    deltatrace_print(d, &m->cpu);
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * print the pending instruction with the changes from its starting state to
+ * after
+ */
+void deltatrace_print(deltatrace_t *d, y86_t *after)
+{
+    if (!d->pending) {
+        return;
+    }
+    d->pending = false;
+
+    y86_t *before = &d->before;
+
+    // registers, flags and status that differ, then the stores that changed
+    // memory
+    char changes[DELTA_CHANGES_SIZE];
+    int len = 0;
+    for (int i = 0; i < NUMREGS; i++) {
+        if (after->reg[i] != before->reg[i]) {
+            len += snprintf(changes + len, sizeof(changes) - len, " %s=%016lx",
+                    DELTA_REG_NAMES[i], after->reg[i]);
+        }
+    }
+    if (after->zf != before->zf) {
+        len += snprintf(changes + len, sizeof(changes) - len, " Z%d", after->zf);
+    }
+    if (after->sf != before->sf) {
+        len += snprintf(changes + len, sizeof(changes) - len, " S%d", after->sf);
+    }
+    if (after->of != before->of) {
+        len += snprintf(changes + len, sizeof(changes) - len, " O%d", after->of);
+    }
+    if (after->stat != before->stat && after->stat <= INS) {
+        len += snprintf(changes + len, sizeof(changes) - len, " %s",
+                DELTA_STAT_NAMES[after->stat]);
+    }
+    for (int i = 0; i < d->nstores; i++) {
+        delta_store_t *s = &d->stores[i];
+        if (s->val != s->old) {
+            len += snprintf(changes + len, sizeof(changes) - len,
+                    " [0x%04lx]=%0*lx", s->addr, (int) s->size * 2, s->val);
+        }
+    }
+
+    // pad the disassembly only when something follows it
+    if (len > 0) {
+        printf("%04lx: %-*s%s\n", d->pc, DELTA_TEXT_WIDTH, d->text, changes);
+    } else {
+        printf("%04lx: %s\n", d->pc, d->text);
+    }
+}
+
+/**
+ * capture the disassembly of inst in d->text
+ */
+void deltatrace_text(deltatrace_t *d, y86_inst_t *inst)
+{
+    rewind(d->text_file);
+    fdisassemble(d->text_file, *inst);
+    fflush(d->text_file);
+
+    long len = ftell(d->text_file);
+    if (len < 0 || len >= DELTA_TEXT_SIZE) {
+        len = 0;
+    }
+    d->text[len] = '\0';
+}
@@ -0,0 +1,113 @@
+#ifndef __CS261_DELTATRACE__
+#define __CS261_DELTATRACE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "p3-disas.h"
+#include "p4-interp.h"
+#include "y86.h"
+
+/* most stores remembered for one instruction (Y86 makes at most one) */
+#define DELTA_MAX_STORES 4
+
+/* room for one disassembled instruction */
+#define DELTA_TEXT_SIZE 64
+
+/* room for everything one instruction can change */
+#define DELTA_CHANGES_SIZE 640
+
+/* width the disassembly is padded to, so the changes line up */
+#define DELTA_TEXT_WIDTH 28
+
+/* one guest store made by the traced instruction */
+typedef struct delta_store {
+
+    address_t addr;
+    uint64_t old;
+    uint64_t val;
+    size_t size;
+
+} delta_store_t;
+
+/* compact trace: one line per instruction with only what it changed, e.g.
+
+     0148: call 0x161                  %rsp=00000000000007f8 [0x07f8]=0000000000000151
+
+   The line is printed once the instruction has finished, at the next fetch
+   or at deltatrace_flush. */
+typedef struct deltatrace {
+
+    bool pending;               // an instruction is waiting to be printed
+    address_t pc;               // its address
+    y86_t before;               // CPU state before it executed
+    char text[DELTA_TEXT_SIZE]; // its disassembly
+    FILE *text_file;            // stream writing into text
+
+    delta_store_t stores[DELTA_MAX_STORES];
+    int nstores;
+
+    uint64_t lines;             // instructions printed so far
+
+} deltatrace_t;
+
+/**
+ * @brief Prepare a compact trace
+ *
+ * @param d Trace to initialize
+ * @returns False if allocation failed
+ */
+bool deltatrace_open (deltatrace_t *d);
+
+/**
+ * @brief Print any pending instruction and release the trace
+ *
+ * @param d Trace to close
+ * @param m Machine being traced
+ */
+void deltatrace_close (deltatrace_t *d, machine_t *m);
+
+/**
+ * @brief Report a fetch from the fetch hook, tracing the instruction or not
+ *
+ * Prints the previous traced instruction first. The first traced instruction
+ * also prints the full CPU state, so later lines have something to be read
+ * against.
+ *
+ * @param d Trace to add to
+ * @param m Machine about to execute the instruction (a failed fetch is
+ *        printed straight away)
+ * @param inst Instruction fetched at m->cpu.pc
+ * @param traced Print this instruction
+ */
+void deltatrace_fetch (deltatrace_t *d, machine_t *m, y86_inst_t *inst,
+        bool traced);
+
+/**
+ * @brief Note a guest store; usable directly as the machine's store hook
+ *
+ * @param arg Trace to add to (deltatrace_t*)
+ * @param addr First address stored to
+ * @param old Previous contents
+ * @param val New contents
+ * @param size Bytes stored
+ */
+void deltatrace_store (void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size);
+
+/**
+ * @brief Print the pending instruction, if any, with what it changed
+ *
+ * Call before instructions run without the fetch hook and when execution
+ * ends, since the changes are read from the machine state.
+ *
+ * @param d Trace to flush
+ * @param m Machine being traced
+ */
+void deltatrace_flush (deltatrace_t *d, machine_t *m);
+
+#endif
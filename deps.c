@@ -0,0 +1,92 @@
+/*
+ * CS 261: Instruction dependence information
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "deps.h"
+
+void get_deps (y86_inst_t inst, bool cnd, y86_reg_t valA, y86_reg_t valE,
+        inst_deps_t *deps)
+{
+    memset(deps, 0x00, sizeof(inst_deps_t));
+    deps->src[0] = deps->src[1] = NOREG;
+    deps->dst[0] = deps->dst[1] = NOREG;
+
+    switch (inst.icode) {
+        case HALT:
+            deps->writes_flags = true;
+            break;
+        case CMOV:
+            deps->src[0] = inst.ra;
+            deps->reads_flags = (inst.ifun.cmov != RRMOVQ);
+            if (cnd) {
+                deps->dst[0] = inst.rb;
+            }
+            break;
+        case IRMOVQ:
+            deps->dst[0] = inst.rb;
+            break;
+        case RMMOVQ:
+            deps->src[0] = inst.ra;
+            deps->src[1] = inst.rb;
+            deps->mem_write = true;
+            deps->mem_addr = valE;
+            break;
+        case MRMOVQ:
+            deps->src[0] = inst.rb;
+            deps->dst[0] = inst.ra;
+            deps->mem_read = true;
+            deps->mem_addr = valE;
+            break;
+        case OPQ:
+            deps->src[0] = inst.ra;
+            deps->src[1] = inst.rb;
+            deps->dst[0] = inst.rb;
+            deps->writes_flags = true;
+            break;
+        case JUMP:
+            deps->reads_flags = (inst.ifun.jump != JMP);
+            break;
+        case CALL:
+            deps->src[0] = RSP;
+            deps->dst[0] = RSP;
+            deps->mem_write = true;
+            deps->mem_addr = valE;
+            break;
+        case RET:
+            deps->src[0] = RSP;
+            deps->dst[0] = RSP;
+            deps->mem_read = true;
+            deps->mem_addr = valA;
+            break;
+        case PUSHQ:
+            deps->src[0] = inst.ra;
+            deps->src[1] = RSP;
+            deps->dst[0] = RSP;
+            deps->mem_write = true;
+            deps->mem_addr = valE;
+            break;
+        case POPQ:
+            deps->src[0] = RSP;
+            deps->dst[0] = RSP;
+            deps->dst[1] = inst.ra;
+            deps->mem_read = true;
+            deps->mem_addr = valA;
+            break;
+        default:
+            break;
+    }
+
+    // a missing register (0xf) is not a real dependence
+    for (int i = 0; i < MAX_SRCS; i++) {
+        if (deps->src[i] >= NOREG) {
+            deps->src[i] = NOREG;
+        }
+    }
+    for (int i = 0; i < MAX_DSTS; i++) {
+        if (deps->dst[i] >= NOREG) {
+            deps->dst[i] = NOREG;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef __CS261_DEPS__
+#define __CS261_DEPS__
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "y86.h"
+
+/* maximum registers read or written by one instruction */
+#define MAX_SRCS 2
+#define MAX_DSTS 2
+
+/* architectural state read and written by one executed instruction */
+typedef struct inst_deps {
+
+    y86_regnum_t src[MAX_SRCS]; // registers read (NOREG if unused)
+    y86_regnum_t dst[MAX_DSTS]; // registers written (NOREG if unused)
+
+    bool reads_flags;           // condition depends on zf/sf/of
+    bool writes_flags;          // zf/sf/of are updated
+
+    bool mem_read;              // loads the word at mem_addr
+    bool mem_write;             // stores the word at mem_addr
+    address_t mem_addr;         // effective address of the memory access
+
+} inst_deps_t;
+
+/**
+ * @brief Work out which registers, flags and memory an instruction used
+ *
+ * @param inst Y86 instruction structure for the executed instruction
+ * @param cnd Condition computed in the execute phase (jumps and moves)
+ * @param valA Value of valA passed to the memory stage
+ * @param valE Value of valE passed to the memory stage
+ * @param deps Pointer to structure to fill in
+ */
+void get_deps (y86_inst_t inst, bool cnd, y86_reg_t valA, y86_reg_t valE,
+        inst_deps_t *deps);
+
+#endif
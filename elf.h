@@ -94,4 +94,20 @@ typedef struct __attribute__((__packed__)) elf_phdr {
     uint32_t magic;         /* DEADBEEF */
 } elf_phdr_t;
 
+/*
+   ELF symbol table entry structure:
+   +-----------------------+
+   |  0  1   |  2  3       |
+   | value   | name        |
+   +-----------------------+
+
+   The symbol table runs from e_symtab up to e_strtab. The value is the
+   symbol's address; the name is the offset of a null-terminated string from
+   the start of the string table, which runs to the end of the file.
+*/
+typedef struct __attribute__((__packed__)) elf_sym {
+    uint16_t st_value;      /* address of the symbol */
+    uint16_t st_name;       /* offset of the name in the string table */
+} elf_sym_t;
+
 #endif
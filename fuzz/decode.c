@@ -0,0 +1,72 @@
+/*
+ * CS 261: Decoder fuzz target
+ *
+ * libFuzzer entry point for fetch() and the disassembler. Each input is
+ * placed so that it ends at the top of the address space, which makes the
+ * last instruction run off the end whenever it is truncated. The memory
+ * buffer is kept between inputs and only the bytes the previous input wrote
+ * are cleared. Build with
+ *
+ *   clang -std=gnu99 -g -O1 -fsanitize=fuzzer,address,undefined -I. \
+ *       -o fuzz-decode fuzz/decode.c p3-disas.c memhook.c
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p3-disas.h"
+
+/* reused by every input */
+byte_t memory[MEMSIZE];
+
+/* bytes at the top of memory written by the previous input */
+size_t dirty = 0;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    // the disassembler only prints
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        abort();
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size > MEMSIZE) {
+        size = MEMSIZE;
+    }
+
+    memset(&memory[MEMSIZE - dirty], 0x00, dirty);
+    memcpy(&memory[MEMSIZE - size], data, size);
+    dirty = size;
+
+    // decode every address, so each byte is also tried as an opcode
+    y86_t cpu;
+    memset(&cpu, 0x00, sizeof(cpu));
+    for (address_t pc = MEMSIZE - size; pc < MEMSIZE; pc++) {
+        cpu.pc = pc;
+        cpu.stat = AOK;
+        y86_inst_t ins = fetch(&cpu, memory);
+        if (cpu.stat == AOK) {
+            disassemble(ins);
+        }
+    }
+
+    // and as the loader would present it: a code segment from its start
+    elf_hdr_t hdr;
+    elf_phdr_t phdr;
+    memset(&hdr, 0x00, sizeof(hdr));
+    memset(&phdr, 0x00, sizeof(phdr));
+    phdr.p_vaddr = MEMSIZE - size;
+    phdr.p_filesz = size;
+    hdr.e_entry = phdr.p_vaddr;
+    disassemble_code(memory, &phdr, &hdr);
+
+    return 0;
+}
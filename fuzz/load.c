@@ -0,0 +1,58 @@
+/*
+ * CS 261: Loader fuzz target
+ *
+ * libFuzzer entry point for the Mini-ELF loader: read_header(), read_phdr(),
+ * load_segment() and the symbol table, through machine_load_buffer() on one
+ * machine kept for the whole session. Build with
+ *
+ *   clang -std=gnu99 -g -O1 -fsanitize=fuzzer,address,undefined -I. \
+ *       -o fuzz-load fuzz/load.c $(ls *.c | grep -v main.c) -lpthread -lm
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+
+/* reused by every input */
+machine_t *machine = NULL;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    machine = machine_create();
+    if (machine == NULL) {
+        abort();
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!machine_load_buffer(machine, data, size)) {
+        return 0;
+    }
+
+    // what was loaded has to be usable: every symbol resolves to itself
+    // and every segment lies in memory
+    symtab_t *symbols = &machine->symbols;
+    for (int i = 0; i < symbols->count; i++) {
+        address_t addr;
+        if (symtab_find(symbols, symbols->syms[i].addr) == NULL
+              || !symtab_resolve(symbols, symbols->syms[i].name, &addr)) {
+            abort();
+        }
+    }
+    for (int i = 0; i < machine->hdr.e_num_phdr; i++) {
+        elf_phdr_t *phdr = &machine->phdrs[i];
+        if (phdr->p_vaddr > MEMSIZE || phdr->p_filesz > MEMSIZE - phdr->p_vaddr) {
+            abort();
+        }
+    }
+
+    return 0;
+}
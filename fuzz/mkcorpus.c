@@ -0,0 +1,139 @@
+/*
+ * CS 261: Fuzz seed corpus generator
+ *
+ * Builds the seed corpus for the fuzz targets from valid Mini-ELF images:
+ * each image as it is and with a small symbol table appended goes to
+ * DIR/elf, and each code segment goes to DIR/code on its own. The corpus in
+ * fuzz/corpus was generated from the benchmark workloads with
+ *
+ *   gcc -std=gnu99 -I. -o mkcorpus fuzz/mkcorpus.c
+ *   mkdir -p fuzz/corpus/elf fuzz/corpus/code
+ *   ./mkcorpus fuzz/corpus bench/images/[a-z]*.o
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elf.h"
+#include "y86.h"
+
+/* largest image accepted */
+#define MAX_IMAGE 65536
+
+/**
+ * write size bytes to DIR/SUB/NAME
+ */
+bool write_file(const char *dir, const char *sub, const char *name,
+        const byte_t *data, size_t size)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s/%s", dir, sub, name);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    fwrite(data, 1, size, file);
+
+    return fclose(file) == 0;
+}
+
+/**
+ * append a symbol table naming the entry point and each segment, and point
+ * the header at it; returns the new image size
+ */
+size_t add_symbols(byte_t *image, size_t size)
+{
+    elf_hdr_t *hdr = (elf_hdr_t*)image;
+    elf_phdr_t *phdrs = (elf_phdr_t*)&image[hdr->e_phdr_start];
+    char strings[256];
+    int len = 0;
+
+    hdr->e_symtab = size;
+    elf_sym_t start = { .st_value = hdr->e_entry, .st_name = len };
+    len += snprintf(strings + len, sizeof(strings) - len, "_start") + 1;
+    memcpy(&image[size], &start, sizeof(start));
+    size += sizeof(start);
+    for (int i = 0; i < hdr->e_num_phdr && i < 8; i++) {
+        elf_sym_t sym = { .st_value = phdrs[i].p_vaddr, .st_name = len };
+        len += snprintf(strings + len, sizeof(strings) - len, "segment%d", i) + 1;
+        memcpy(&image[size], &sym, sizeof(sym));
+        size += sizeof(sym);
+    }
+
+    hdr->e_strtab = size;
+    memcpy(&image[size], strings, len);
+    return size + len;
+}
+
+int main (int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("Usage: %s corpus-dir mini-elf-file...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    byte_t *image = (byte_t*)malloc(MAX_IMAGE + 512);
+    if (image == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    for (int a = 2; a < argc; a++) {
+        FILE *file = fopen(argv[a], "rb");
+        if (file == NULL) {
+            printf("Failed to read %s\n", argv[a]);
+            return EXIT_FAILURE;
+        }
+        size_t size = fread(image, 1, MAX_IMAGE, file);
+        fclose(file);
+
+        elf_hdr_t *hdr = (elf_hdr_t*)image;
+        if (size < sizeof(elf_hdr_t)
+              || hdr->e_phdr_start + hdr->e_num_phdr * sizeof(elf_phdr_t) > size) {
+            printf("Not a Mini-ELF image: %s\n", argv[a]);
+            return EXIT_FAILURE;
+        }
+
+        char name[256];
+        snprintf(name, sizeof(name), "%s", basename(argv[a]));
+        char *dot = strrchr(name, '.');
+        if (dot != NULL) {
+            *dot = '\0';
+        }
+
+        // each code segment on its own, for the decoder
+        elf_phdr_t *phdrs = (elf_phdr_t*)&image[hdr->e_phdr_start];
+        bool ok = write_file(argv[1], "elf", name, image, size);
+        for (int i = 0; ok && i < hdr->e_num_phdr; i++) {
+            if (phdrs[i].p_type == CODE && phdrs[i].p_filesz > 0
+                  && phdrs[i].p_offset + phdrs[i].p_filesz <= size) {
+                char seg[300];
+                snprintf(seg, sizeof(seg), "%s-%d", name, i);
+                ok = write_file(argv[1], "code", seg, &image[phdrs[i].p_offset],
+                        phdrs[i].p_filesz);
+            }
+        }
+
+        // and the whole image again with symbols, unless it has them already
+        if (ok && hdr->e_symtab == 0) {
+            char sym[300];
+            snprintf(sym, sizeof(sym), "%s-sym", name);
+            size = add_symbols(image, size);
+            ok = write_file(argv[1], "elf", sym, image, size);
+        }
+
+        if (!ok) {
+            printf("Failed to write corpus for %s\n", argv[a]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    free(image);
+    return EXIT_SUCCESS;
+}
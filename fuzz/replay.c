@@ -0,0 +1,119 @@
+/*
+ * CS 261: Fuzz target replay driver
+ *
+ * Stands in for libFuzzer where it is not available: runs a fuzz target on
+ * each file named on the command line, passes times over, and reports the
+ * executions per second on standard error. Useful for reproducing a crash
+ * or for regression runs over the corpus with gcc's sanitizers, e.g.
+ *
+ *   gcc -std=gnu99 -g -O1 -fsanitize=address,undefined -I. -o replay-run \
+ *       fuzz/replay.c fuzz/run.c $(ls *.c | grep -v main.c) -lpthread -lm
+ *   ./replay-run -n 100 fuzz/corpus/elf/[a-z]*
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* largest input read from a file */
+#define MAX_INPUT 65536
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* one input file */
+typedef struct input {
+
+    uint8_t *data;
+    size_t size;
+
+} input_t;
+
+/**
+ * seconds on the monotonic clock
+ */
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * read a whole file (up to MAX_INPUT bytes), returning false on failure
+ */
+bool read_input(const char *filename, input_t *in)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    in->data = (uint8_t*)malloc(MAX_INPUT);
+    if (in->data == NULL) {
+        fclose(file);
+        return false;
+    }
+    in->size = fread(in->data, 1, MAX_INPUT, file);
+    fclose(file);
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    long passes = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                passes = strtol(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n passes] input...\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind == argc || passes < 1) {
+        fprintf(stderr, "Usage: %s [-n passes] input...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int count = argc - optind;
+    input_t *inputs = (input_t*)calloc(count, sizeof(input_t));
+    if (inputs == NULL) {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!read_input(argv[optind + i], &inputs[i])) {
+            fprintf(stderr, "Failed to read %s\n", argv[optind + i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    double start = now();
+    for (long p = 0; p < passes; p++) {
+        for (int i = 0; i < count; i++) {
+            LLVMFuzzerTestOneInput(inputs[i].data, inputs[i].size);
+        }
+    }
+    double elapsed = now() - start;
+
+    fprintf(stderr, "%ld executions in %.3f s (%.0f/s)\n", passes * count,
+            elapsed, elapsed > 0 ? passes * count / elapsed : 0.0);
+
+    for (int i = 0; i < count; i++) {
+        free(inputs[i].data);
+    }
+    free(inputs);
+    return EXIT_SUCCESS;
+}
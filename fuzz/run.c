@@ -0,0 +1,72 @@
+/*
+ * CS 261: Load-and-run fuzz target
+ *
+ * libFuzzer entry point that loads each input as a Mini-ELF image and runs
+ * it for at most FUZZ_BUDGET instructions on one machine kept for the whole
+ * session. The run is then repeated after machine_reset(), which restores
+ * only the memory the guest dirtied, and both runs must end in the same
+ * state. Guest output goes to /dev/null and guest input reads end of file.
+ * Build with
+ *
+ *   clang -std=gnu99 -g -O1 -fsanitize=fuzzer,address,undefined -I. \
+ *       -o fuzz-run fuzz/run.c $(ls *.c | grep -v main.c) -lpthread -lm
+ *
+ * Name: Dylan Moreno
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+
+/* instructions each run may execute */
+#define FUZZ_BUDGET 2000
+
+/* reused by every input */
+machine_t *machine = NULL;
+
+/* memory at the end of the first run */
+byte_t first_memory[MEMSIZE];
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    if (freopen("/dev/null", "w", stdout) == NULL
+          || freopen("/dev/null", "r", stdin) == NULL) {
+        abort();
+    }
+
+    machine = machine_create();
+    if (machine == NULL) {
+        abort();
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!machine_load_buffer(machine, data, size)) {
+        return 0;
+    }
+
+    machine_run(machine, FUZZ_BUDGET);
+    y86_t first = machine->cpu;
+    uint64_t count = machine->count;
+    memcpy(first_memory, machine->memory, MEMSIZE);
+
+    // a reset run has to retrace the first one exactly
+    machine_reset(machine);
+    machine_run(machine, FUZZ_BUDGET);
+    y86_t *cpu = &machine->cpu;
+    if (memcmp(first.reg, cpu->reg, sizeof(first.reg)) != 0
+          || first.pc != cpu->pc || first.stat != cpu->stat
+          || first.zf != cpu->zf || first.sf != cpu->sf || first.of != cpu->of
+          || count != machine->count
+          || memcmp(first_memory, machine->memory, MEMSIZE) != 0) {
+        abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,556 @@
+/*
+ * CS 261: GDB remote stub
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "gdbstub.h"
+
+/* registers in GDB's x86-64 order; %r15 does not exist and reads as zero */
+#define GDB_NUM_REGS 16
+#define GDB_REG_RIP 16
+#define GDB_REG_EFLAGS 17
+
+/* x86-64 eflags bits that carry the Y86 condition codes */
+#define EFLAGS_ZF (1 << 6)
+#define EFLAGS_SF (1 << 7)
+#define EFLAGS_OF (1 << 11)
+
+const y86_regnum_t GDB_REGS[GDB_NUM_REGS] = {
+    RAX, RBX, RCX, RDX, RSI, RDI, RBP, RSP,
+    R8, R9, R10, R11, R12, R13, R14, NOREG
+};
+
+int gdb_listen(const char *where);
+int get_char(gdb_conn_t *conn);
+int get_packet(gdb_conn_t *conn, char *buf);
+bool put_packet(gdb_conn_t *conn, const char *data);
+bool interrupted(gdb_conn_t *conn);
+void stop_reply(machine_t *m, bool interrupt, char *out);
+void resume(machine_t *m, gdb_conn_t *conn, bool step, char *out);
+void reverse(machine_t *m, bool step, char *out);
+void read_regs(machine_t *m, char *out);
+bool write_reg(machine_t *m, int n, const char *hex);
+uint64_t gdb_reg(machine_t *m, int n);
+int hex_digit(char c);
+void put_hex(char *out, uint64_t v, int bytes);
+uint64_t get_hex(const char *in, int bytes);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool gdb_serve (machine_t *m, const char *where)
+{
+    int server = gdb_listen(where);
+    if (server < 0) {
+        return false;
+    }
+
+    printf("Waiting for GDB on %s\n", where);
+    fflush(stdout);
+
+    gdb_conn_t conn;
+    memset(&conn, 0x00, sizeof(gdb_conn_t));
+    conn.ack = true;
+    conn.fd = accept(server, NULL, NULL);
+    close(server);
+    if (conn.fd < 0) {
+        return false;
+    }
+
+    char *buf = (char*)malloc(GDB_PACKET_SIZE + 1);
+    char *out = (char*)malloc(2 * GDB_PACKET_SIZE + 1);
+    if (buf == NULL || out == NULL) {
+        free(buf);
+        free(out);
+        close(conn.fd);
+        return false;
+    }
+
+    // serve requests until the debugger goes away
+    bool done = false;
+    while (!done && get_packet(&conn, buf) >= 0) {
+        char *p = buf + 1;
+        uint64_t addr;
+        uint64_t len;
+        long n;
+        out[0] = '\0';
+
+        switch (buf[0]) {
+            case '?':
+                stop_reply(m, false, out);
+                break;
+            case 'g':
+                read_regs(m, out);
+                break;
+            case 'G':
+                // a short packet sets the leading registers only
+                for (n = 0; n <= GDB_REG_EFLAGS && write_reg(m, n, p); n++) {
+                    p += (n == GDB_REG_EFLAGS) ? 8 : 16;
+                }
+                strcpy(out, "OK");
+                break;
+            case 'p':
+                n = strtol(p, NULL, 16);
+                if (n >= 0 && n <= GDB_REG_EFLAGS) {
+                    put_hex(out, gdb_reg(m, n), n == GDB_REG_EFLAGS ? 4 : 8);
+                } else {
+                    strcpy(out, "E01");
+                }
+                break;
+            case 'P':
+                n = strtol(p, &p, 16);
+                strcpy(out, (*p == '=' && n >= 0 && n <= GDB_REG_EFLAGS
+                            && write_reg(m, n, p + 1)) ? "OK" : "E01");
+                break;
+            case 'm':
+                addr = strtoull(p, &p, 16);
+                len = (*p == ',') ? strtoull(p + 1, NULL, 16) : 0;
+                if (addr >= MEMSIZE) {
+                    strcpy(out, "E01");
+                    break;
+                }
+                // a read running off the end of memory returns what exists
+                if (len > GDB_PACKET_SIZE / 2) {
+                    len = GDB_PACKET_SIZE / 2;
+                }
+                if (addr + len > MEMSIZE) {
+                    len = MEMSIZE - addr;
+                }
+                for (uint64_t i = 0; i < len; i++) {
+                    put_hex(out + 2 * i, m->memory[addr + i], 1);
+                }
+                break;
+            case 'M':
+                addr = strtoull(p, &p, 16);
+                len = (*p == ',') ? strtoull(p + 1, &p, 16) : 0;
+                if (*p != ':' || addr >= MEMSIZE || len > MEMSIZE - addr
+                      || strlen(p + 1) < 2 * len) {
+                    strcpy(out, "E01");
+                    break;
+                }
+                for (uint64_t i = 0; i < len; i++) {
+                    m->memory[addr + i] = get_hex(p + 1 + 2 * i, 1);
+                }
+                machine_mark_dirty(m, addr, len);
+                if (m->journal != NULL) {
+                    journal_reset(m->journal, m->count);
+                }
+                strcpy(out, "OK");
+                break;
+            case 'c':
+            case 's':
+                if (*p != '\0') {
+                    m->cpu.pc = strtoull(p, NULL, 16);
+                }
+                resume(m, &conn, buf[0] == 's', out);
+                break;
+            case 'b':
+                if (m->journal != NULL && (*p == 's' || *p == 'c')) {
+                    reverse(m, *p == 's', out);
+                }
+                break;
+            case 'Z':
+            case 'z':
+                n = *p - '0';
+                if (n < 0 || n > 4 || p[1] != ',') {
+                    break;
+                }
+                addr = strtoull(p + 2, &p, 16);
+                len = (*p == ',') ? strtoull(p + 1, NULL, 16) : 0;
+                if (n <= 1) {
+                    // software and hardware breakpoints are the same thing here
+                    strcpy(out, machine_set_break(m, addr, buf[0] == 'Z') ? "OK" : "E01");
+                } else if (buf[0] == 'Z') {
+                    // 2 is a write watchpoint, 3 read and 4 either
+                    strcpy(out, machine_watch(m, addr, len, n != 2, n != 3) ? "OK" : "E01");
+                } else {
+                    strcpy(out, machine_unwatch(m, addr, len, n != 2, n != 3) ? "OK" : "E01");
+                }
+                break;
+            case 'q':
+                if (strncmp(p, "Supported", 9) == 0) {
+                    snprintf(out, GDB_PACKET_SIZE,
+                            "PacketSize=%x;QStartNoAckMode+;swbreak+;hwbreak+%s",
+                            GDB_PACKET_SIZE, m->journal != NULL
+                            ? ";ReverseStep+;ReverseContinue+" : "");
+                } else if (strcmp(p, "Attached") == 0) {
+                    strcpy(out, "1");
+                }
+                break;
+            case 'Q':
+                if (strcmp(p, "StartNoAckMode") == 0) {
+                    strcpy(out, "OK");
+                    put_packet(&conn, out);
+                    conn.ack = false;
+                    continue;
+                }
+                break;
+            case 'H':
+            case 'T':
+                strcpy(out, "OK");
+                break;
+            case 'D':
+                strcpy(out, "OK");
+                done = true;
+                break;
+            case 'k':
+                done = true;
+                continue;
+            default:
+                // unsupported packets get an empty reply
+                break;
+        }
+
+        if (!put_packet(&conn, out)) {
+            break;
+        }
+    }
+
+    free(buf);
+    free(out);
+    close(conn.fd);
+
+    return true;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * open a listening socket: a TCP port on the loopback address if the name
+ * is all digits, otherwise a Unix socket at that path
+ */
+int gdb_listen(const char *where)
+{
+    bool tcp = where[0] != '\0' && strspn(where, "0123456789") == strlen(where);
+    int fd;
+
+    if (tcp) {
+        struct sockaddr_in sa;
+        memset(&sa, 0x00, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(atoi(where));
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int one = 1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un sa;
+        memset(&sa, 0x00, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(where) >= sizeof(sa.sun_path)) {
+            return -1;
+        }
+        strcpy(sa.sun_path, where);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        unlink(where);
+        if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * read one byte from the debugger (-1 once the connection is gone)
+ */
+int get_char(gdb_conn_t *conn)
+{
+    if (conn->in_pos == conn->in_len) {
+        ssize_t got = recv(conn->fd, conn->in, sizeof(conn->in), 0);
+        if (got <= 0) {
+            return -1;
+        }
+        conn->in_len = got;
+        conn->in_pos = 0;
+    }
+    return (unsigned char)conn->in[conn->in_pos++];
+}
+
+/**
+ * receive the next packet with a good checksum into buf (null-terminated);
+ * returns its length, or -1 once the connection is gone
+ */
+int get_packet(gdb_conn_t *conn, char *buf)
+{
+    while (true) {
+        int c;
+
+        // skip acknowledgements and stray interrupts between packets
+        do {
+            c = get_char(conn);
+            if (c < 0) {
+                return -1;
+            }
+        } while (c != '$');
+
+        int len = 0;
+        uint8_t sum = 0;
+        while ((c = get_char(conn)) != '#') {
+            if (c < 0) {
+                return -1;
+            }
+            if (len < GDB_PACKET_SIZE) {
+                buf[len++] = c;
+            }
+            sum += c;
+        }
+        buf[len] = '\0';
+
+        int hi = get_char(conn);
+        int lo = get_char(conn);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+
+        bool good = hex_digit(hi) >= 0 && hex_digit(lo) >= 0
+            && ((hex_digit(hi) << 4) | hex_digit(lo)) == sum;
+        if (conn->ack) {
+            send(conn->fd, good ? "+" : "-", 1, MSG_NOSIGNAL);
+        }
+        if (good || !conn->ack) {
+            return len;
+        }
+    }
+}
+
+/**
+ * send a packet, resending until the debugger acknowledges it
+ */
+bool put_packet(gdb_conn_t *conn, const char *data)
+{
+    size_t len = strlen(data);
+    char *frame = (char*)malloc(len + 5);
+    if (frame == NULL) {
+        return false;
+    }
+
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += (uint8_t)data[i];
+    }
+    frame[0] = '$';
+    memcpy(frame + 1, data, len);
+    snprintf(frame + len + 1, 4, "#%02x", sum);
+
+    bool ok = send(conn->fd, frame, len + 4, MSG_NOSIGNAL) == (ssize_t)(len + 4);
+    while (ok && conn->ack) {
+        int c = get_char(conn);
+        if (c == '+') {
+            break;
+        } else if (c == '-') {
+            ok = send(conn->fd, frame, len + 4, MSG_NOSIGNAL) == (ssize_t)(len + 4);
+        } else if (c < 0) {
+            ok = false;
+        }
+    }
+    free(frame);
+
+    return ok;
+}
+
+/**
+ * check, without waiting, whether the debugger sent an interrupt (^C)
+ */
+bool interrupted(gdb_conn_t *conn)
+{
+    struct pollfd pfd = { .fd = conn->fd, .events = POLLIN };
+
+    while (conn->in_pos < conn->in_len || poll(&pfd, 1, 0) > 0) {
+        int c = get_char(conn);
+        if (c < 0 || c == 0x03) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * describe why the program stopped: halting is an exit, faults are signals
+ * and a limit or detected loop ends the program with the simulator's
+ * "stopped" exit status
+ */
+void stop_reply(machine_t *m, bool interrupt, char *out)
+{
+    if (interrupt) {
+        strcpy(out, "S02");                 // SIGINT
+    } else if (m->cpu.stat == HLT) {
+        strcpy(out, "W00");
+    } else if (m->cpu.stat == ADR) {
+        strcpy(out, "S0b");                 // SIGSEGV
+    } else if (m->cpu.stat == INS) {
+        strcpy(out, "S04");                 // SIGILL
+    } else if (m->stop == STOP_BUDGET || m->stop == STOP_TIMEOUT
+          || m->stop == STOP_LOOP) {
+        strcpy(out, "W02");
+    } else if (m->stop == STOP_WATCH) {
+        // report the watched address so GDB can find its watchpoint
+        address_t addr = m->hit.addr > m->hit.watch.start
+            ? m->hit.addr : m->hit.watch.start;
+        snprintf(out, GDB_PACKET_SIZE, "T05%s:%lx;",
+                !m->hit.watch.read ? "watch" : !m->hit.watch.write
+                ? "rwatch" : "awatch", addr);
+    } else if (m->stop == STOP_BREAK) {
+        // says the PC is at the breakpoint, not one byte past it as on x86
+        strcpy(out, "T05swbreak:;");
+    } else {
+        strcpy(out, "S05");                 // SIGTRAP
+    }
+}
+
+/**
+ * single-step or continue; a continue runs at full speed in batches,
+ * looking for an interrupt between them
+ */
+void resume(machine_t *m, gdb_conn_t *conn, bool step, char *out)
+{
+    bool interrupt = false;
+
+    if (m->stop == STOP_BREAK || m->stop == STOP_WATCH) {
+        m->stop = STOP_NONE;
+    }
+
+    if (step) {
+        machine_step(m);
+    } else {
+        while (machine_running(m)) {
+            machine_run(m, GDB_POLL_BATCH);
+            if (machine_running(m) && interrupted(conn)) {
+                interrupt = true;
+                break;
+            }
+        }
+    }
+
+    stop_reply(m, interrupt, out);
+}
+
+/**
+ * step or continue backward through the undo journal; running out of
+ * history is reported the way GDB expects for a replay log
+ */
+void reverse(machine_t *m, bool step, char *out)
+{
+    do {
+        if (!machine_step_back(m)) {
+            strcpy(out, "T05replaylog:begin;");
+            return;
+        }
+    } while (!step && !machine_is_break(m, m->cpu.pc));
+
+    strcpy(out, "S05");
+}
+
+/**
+ * encode every register for a 'g' reply
+ */
+void read_regs(machine_t *m, char *out)
+{
+    for (int n = 0; n <= GDB_REG_EFLAGS; n++) {
+        put_hex(out, gdb_reg(m, n), n == GDB_REG_EFLAGS ? 4 : 8);
+        out += (n == GDB_REG_EFLAGS) ? 8 : 16;
+    }
+}
+
+/**
+ * set register n from its hex encoding; edits invalidate the undo journal
+ */
+bool write_reg(machine_t *m, int n, const char *hex)
+{
+    int bytes = (n == GDB_REG_EFLAGS) ? 4 : 8;
+    if (n < 0 || n > GDB_REG_EFLAGS || strlen(hex) < 2 * (size_t) bytes) {
+        return false;
+    }
+
+    uint64_t v = get_hex(hex, bytes);
+    if (n < GDB_NUM_REGS) {
+        if (GDB_REGS[n] != NOREG) {
+            m->cpu.reg[GDB_REGS[n]] = v;
+        }
+    } else if (n == GDB_REG_RIP) {
+        m->cpu.pc = v;
+    } else {
+        m->cpu.zf = (v & EFLAGS_ZF) != 0;
+        m->cpu.sf = (v & EFLAGS_SF) != 0;
+        m->cpu.of = (v & EFLAGS_OF) != 0;
+    }
+
+    if (m->journal != NULL) {
+        journal_reset(m->journal, m->count);
+    }
+    return true;
+}
+
+/**
+ * value of register n in GDB's numbering
+ */
+uint64_t gdb_reg(machine_t *m, int n)
+{
+    if (n < GDB_NUM_REGS) {
+        return GDB_REGS[n] == NOREG ? 0 : m->cpu.reg[GDB_REGS[n]];
+    } else if (n == GDB_REG_RIP) {
+        return m->cpu.pc;
+    }
+    return (m->cpu.zf ? EFLAGS_ZF : 0) | (m->cpu.sf ? EFLAGS_SF : 0)
+        | (m->cpu.of ? EFLAGS_OF : 0);
+}
+
+/**
+ * value of one hex digit (-1 if it is not one)
+ */
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * write a value as little-endian hex bytes (null-terminated)
+ */
+void put_hex(char *out, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        snprintf(out + 2 * i, 3, "%02x", (unsigned)((v >> (8 * i)) & 0xff));
+    }
+}
+
+/**
+ * read a value from little-endian hex bytes
+ */
+uint64_t get_hex(const char *in, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        int hi = hex_digit(in[2 * i]);
+        int lo = hex_digit(in[2 * i + 1]);
+        v = (v << 8) | (((hi < 0 ? 0 : hi) << 4) | (lo < 0 ? 0 : lo));
+    }
+    return v;
+}
@@ -0,0 +1,53 @@
+#ifndef __CS261_GDBSTUB__
+#define __CS261_GDBSTUB__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "machine.h"
+#include "y86.h"
+
+/* largest packet the stub accepts or sends, in bytes of payload */
+#define GDB_PACKET_SIZE 4096
+
+/* instructions run between checks for an interrupt from the debugger */
+#define GDB_POLL_BATCH (1 << 20)
+
+/* one debugger connection */
+typedef struct gdb_conn {
+
+    int fd;                     // connected socket
+    bool ack;                   // packets are acknowledged (until no-ack mode)
+    char in[512];               // bytes received but not yet consumed
+    size_t in_len;
+    size_t in_pos;
+
+} gdb_conn_t;
+
+/**
+ * @brief Serve the GDB Remote Serial Protocol for a machine
+ *
+ * Waits for one debugger connection, then lets it read and write registers
+ * and memory, set breakpoints, single-step and continue until it detaches
+ * or kills the program. Registers are presented in the
+ * x86-64 layout (%rax, %rbx, %rcx, %rdx, %rsi, %rdi, %rbp, %rsp, %r8-%r15,
+ * %rip, eflags), so an x86-64 GDB can connect with "target remote". If the
+ * machine records an undo journal, reverse-stepi and reverse-continue work
+ * too.
+ *
+ * @param m Machine to debug, loaded and ready to run
+ * @param where TCP port on 127.0.0.1, or a path for a Unix socket
+ * @returns False if the socket could not be set up
+ */
+bool gdb_serve (machine_t *m, const char *where);
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * CS 261: Input trap record and replay
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "inputlog.h"
+
+bool inputlog_append(inputlog_t *l, inputlog_rec_t *rec);
+bool inputlog_next(inputlog_t *l, inputlog_rec_t *rec);
+const char *inputlog_trap_name(y86_iotrap_t trap);
+uint64_t inputlog_seek(inputlog_t *l, uint64_t count);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool inputlog_record (inputlog_t *l, const char *filename, machine_t *m)
+{
+    memset(l, 0x00, sizeof(inputlog_t));
+    l->m = m;
+    l->filename = filename;
+
+    l->cap = 4096;
+    l->buf = (byte_t*)malloc(l->cap);
+    return l->buf != NULL;
+}
+
+bool inputlog_replay (inputlog_t *l, const char *filename, machine_t *m)
+{
+    memset(l, 0x00, sizeof(inputlog_t));
+    l->m = m;
+    l->replay = true;
+    l->filename = filename;
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // check the header, then read the rest of the file into memory
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    bool ok = fread(magic, 1, 4, file) == 4
+        && memcmp(magic, INPUTLOG_MAGIC, 4) == 0
+        && fread(&version, 2, 1, file) == 1 && version == INPUTLOG_VERSION
+        && fread(&reserved, 2, 1, file) == 1;
+    while (ok) {
+        if (l->len == l->cap) {
+            size_t cap = l->cap > 0 ? l->cap * 2 : 4096;
+            byte_t *buf = (byte_t*)realloc(l->buf, cap);
+            if (buf == NULL) {
+                ok = false;
+                break;
+            }
+            l->buf = buf;
+            l->cap = cap;
+        }
+        size_t got = fread(l->buf + l->len, 1, l->cap - l->len, file);
+        l->len += got;
+        if (got == 0) {
+            ok = !ferror(file);
+            break;
+        }
+    }
+    fclose(file);
+
+    // decode it all once, so a damaged log is refused before the run
+    inputlog_rec_t rec;
+    while (ok && l->pos < l->len) {
+        ok = inputlog_next(l, &rec);
+        l->total++;
+    }
+    if (!ok) {
+        free(l->buf);
+        l->buf = NULL;
+        return false;
+    }
+
+    // skip what was read before the point the machine starts from
+    l->skipped = inputlog_seek(l, m->count);
+    l->total -= l->skipped;
+
+    return true;
+}
+
+int inputlog_read (void *arg, y86_iotrap_t trap, int *value)
+{
+    inputlog_t *l = (inputlog_t*)arg;
+    inputlog_rec_t rec;
+    memset(&rec, 0x00, sizeof(rec));
+
+    if (!l->replay) {
+        rec.count = l->m->count;
+        rec.trap = trap;
+        rec.result = iotrap_read_input(trap, &rec.value);
+        if (!inputlog_append(l, &rec)) {
+            // keep the program running on what it read; the log is lost
+            free(l->buf);
+            l->buf = NULL;
+        }
+        *value = rec.value;
+        return rec.result;
+    }
+
+    // the next record must be for this very trap
+    size_t pos = l->pos;
+    uint64_t last = l->last;
+    bool more = l->pos < l->len && inputlog_next(l, &rec);
+    if (!more || rec.count != l->m->count || rec.trap != trap) {
+        l->pos = pos;
+        l->last = last;
+        l->diverged = true;
+        l->exhausted = !more;
+        l->expected = rec;
+        l->count = l->m->count;
+        l->trap = trap;
+        l->pc = l->m->cpu.pc;
+        machine_stop(l->m, STOP_INPUT);
+        return INPUT_NONE;
+    }
+
+    l->values++;
+    *value = rec.value;
+    return rec.result;
+}
+
+bool inputlog_rewind (machine_t *m, void *arg, uint64_t count)
+{
+    inputlog_t *l = (inputlog_t*)arg;
+    if (!l->replay) {
+        return false;
+    }
+
+    l->values = inputlog_seek(l, count) - l->skipped;
+    l->diverged = false;
+    return true;
+}
+
+bool inputlog_close (inputlog_t *l)
+{
+    bool ok = true;
+
+    if (!l->replay) {
+        FILE *file = fopen(l->filename, "wb");
+        uint16_t version = INPUTLOG_VERSION;
+        uint16_t reserved = 0;
+        ok = file != NULL && l->buf != NULL
+            && fwrite(INPUTLOG_MAGIC, 1, 4, file) == 4
+            && fwrite(&version, 2, 1, file) == 1
+            && fwrite(&reserved, 2, 1, file) == 1
+            && fwrite(l->buf, 1, l->len, file) == l->len;
+        if (file != NULL) {
+            ok = (fclose(file) == 0) && ok;
+        }
+    }
+
+    free(l->buf);
+    l->buf = NULL;
+    return ok;
+}
+
+void dump_inputlog (inputlog_t *l)
+{
+    if (!l->replay) {
+        printf("Input log: %" PRIu64 " values recorded in %zu bytes\n",
+                l->values, l->len + INPUTLOG_HEADER_SIZE);
+        return;
+    }
+
+    printf("Input replay: %" PRIu64 " of %" PRIu64 " values used\n",
+            l->values, l->total);
+    if (l->diverged) {
+        printf("  %s trap at 0x%04lx after %" PRIu64 " instructions\n",
+                inputlog_trap_name(l->trap), l->pc, l->count);
+        if (l->exhausted) {
+            printf("  the log has no more values\n");
+        } else {
+            printf("  the log expected %s after %" PRIu64 " instructions\n",
+                    inputlog_trap_name(l->expected.trap), l->expected.count);
+        }
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * encode one record at the end of the buffer, growing it if needed
+ */
+bool inputlog_append(inputlog_t *l, inputlog_rec_t *rec)
+{
+    if (l->buf == NULL) {
+        return false;
+    }
+    if (l->cap - l->len < INPUTLOG_MAX_RECORD) {
+        byte_t *buf = (byte_t*)realloc(l->buf, l->cap * 2);
+        if (buf == NULL) {
+            return false;
+        }
+        l->buf = buf;
+        l->cap *= 2;
+    }
+
+    int kind = rec->result == 1 ? INPUTLOG_VALUE
+        : rec->result == 0 ? INPUTLOG_NOMATCH : INPUTLOG_EOF;
+    byte_t *out = varint_put(l->buf + l->len, rec->count - l->last);
+    *out++ = rec->trap | (kind << 3);
+    if (kind == INPUTLOG_VALUE) {
+        if (rec->trap == CHARIN) {
+            *out++ = rec->value;
+        } else {
+            out = varint_put(out, rec->value);
+        }
+    }
+
+    l->len = out - l->buf;
+    l->last = rec->count;
+    l->values++;
+    return true;
+}
+
+/**
+ * decode the record at pos and move past it; false if it is damaged or cut
+ * short
+ */
+bool inputlog_next(inputlog_t *l, inputlog_rec_t *rec)
+{
+    int64_t delta;
+    if (!varint_get(l->buf, l->len, &l->pos, &delta) || delta < 0 || l->pos == l->len) {
+        return false;
+    }
+
+    byte_t tag = l->buf[l->pos++];
+    int kind = (tag >> 3) & 0x3;
+    rec->count = l->last + delta;
+    rec->trap = (y86_iotrap_t)(tag & 0x7);
+    if ((rec->trap != CHARIN && rec->trap != DECIN) || kind > INPUTLOG_EOF
+          || (tag >> 5) != 0) {
+        return false;
+    }
+
+    rec->value = 0;
+    if (kind == INPUTLOG_VALUE) {
+        rec->result = 1;
+        if (rec->trap == CHARIN) {
+            if (l->pos == l->len) {
+                return false;
+            }
+            rec->value = l->buf[l->pos++];
+        } else {
+            int64_t v;
+            if (!varint_get(l->buf, l->len, &l->pos, &v) || v < INT32_MIN || v > INT32_MAX) {
+                return false;
+            }
+            rec->value = (int)v;
+        }
+    } else {
+        rec->result = kind == INPUTLOG_NOMATCH ? 0 : EOF;
+    }
+
+    l->last = rec->count;
+    return true;
+}
+
+/**
+ * move to the first record at or after count, and return the number of
+ * records before it
+ */
+uint64_t inputlog_seek(inputlog_t *l, uint64_t count)
+{
+    inputlog_rec_t rec;
+    uint64_t n = 0;
+    size_t pos = 0;
+    uint64_t last = 0;
+
+    l->pos = 0;
+    l->last = 0;
+    while (inputlog_next(l, &rec) && rec.count < count) {
+        pos = l->pos;
+        last = rec.count;
+        n++;
+    }
+    l->pos = pos;
+    l->last = last;
+
+    return n;
+}
+
+/**
+ * name of an input trap for reports
+ */
+const char *inputlog_trap_name(y86_iotrap_t trap)
+{
+    return trap == CHARIN ? "CHARIN" : "DECIN";
+}
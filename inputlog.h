@@ -0,0 +1,152 @@
+#ifndef __CS261_INPUTLOG__
+#define __CS261_INPUTLOG__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "p4-interp.h"
+#include "varint.h"
+#include "y86.h"
+
+/* input log file format:
+
+     header     magic "Y86I", u16 version, u16 reserved (zero)
+     records    one per input trap, in execution order, until end of file
+
+   Each record is:
+
+     count      varint: instructions executed before the trap, minus the
+                count of the previous record (the first is taken from zero)
+     tag        bits 0-2 trap (1 CHARIN, 3 DECIN), bits 3-4 result (0 a value
+                follows, 1 DECIN found no number, 2 end of input), bits 5-7
+                reserved (zero)
+     value      CHARIN: the character, one byte; DECIN: varint
+
+   Varints are described in varint.h. A program reading one character at a
+   time costs three bytes per value. */
+#define INPUTLOG_MAGIC "Y86I"
+#define INPUTLOG_VERSION 1
+#define INPUTLOG_HEADER_SIZE 8
+
+/* largest encoded record: two varints and the tag */
+#define INPUTLOG_MAX_RECORD 21
+
+/* result kinds in a record's tag */
+#define INPUTLOG_VALUE 0
+#define INPUTLOG_NOMATCH 1
+#define INPUTLOG_EOF 2
+
+/* one input trap */
+typedef struct inputlog_rec {
+
+    uint64_t count;             // instructions executed before the trap
+    y86_iotrap_t trap;          // CHARIN or DECIN
+    int result;                 // scanf result: 1, 0 or EOF
+    int value;                  // value read (if result is 1)
+
+} inputlog_rec_t;
+
+/* input traps being recorded from standard input, or replayed from memory */
+typedef struct inputlog {
+
+    machine_t *m;               // machine whose count the records use
+    bool replay;
+    const char *filename;
+
+    byte_t *buf;                // encoded records (without the header)
+    size_t len;
+    size_t cap;
+    size_t pos;                 // next record to replay
+    uint64_t last;              // count of the previous record
+
+    uint64_t values;            // records written, or replayed
+    uint64_t total;             // records in the log (replay only)
+    uint64_t skipped;           // records before the starting count (replay)
+
+    // the first input trap that does not match the log
+    bool diverged;
+    bool exhausted;             // the log had no more records
+    inputlog_rec_t expected;    // next record in the log
+    uint64_t count;             // the trap that asked instead
+    y86_iotrap_t trap;
+    address_t pc;
+
+} inputlog_t;
+
+/**
+ * @brief Start recording every input trap value read from standard input
+ *
+ * @param l Log to initialize
+ * @param filename File written by inputlog_close
+ * @param m Machine about to run
+ * @returns False if memory runs out
+ */
+bool inputlog_record (inputlog_t *l, const char *filename, machine_t *m);
+
+/**
+ * @brief Load a recorded log to feed input traps from, without reading
+ * standard input
+ *
+ * The whole log is read into memory. Records before the machine's current
+ * count are skipped, so a run resumed from a checkpoint (-r) picks up where
+ * the log does.
+ *
+ * @param l Log to initialize
+ * @param filename Log written by an earlier recording
+ * @param m Machine about to run (loaded, or restored from a checkpoint)
+ * @returns False if the file is missing, is not an input log or is damaged
+ */
+bool inputlog_replay (inputlog_t *l, const char *filename, machine_t *m);
+
+/**
+ * @brief Input hook (input_hook_t) for set_input_hook, with the log as its
+ * argument
+ *
+ * When recording, reads standard input and logs the result. When replaying,
+ * returns the next record if the trap and instruction count match it;
+ * otherwise the divergence is noted, the run is stopped with STOP_INPUT and
+ * the trap reads nothing.
+ *
+ * @param arg The log
+ * @param trap CHARIN or DECIN
+ * @param value Value read
+ * @returns The scanf result of the recorded read, or INPUT_NONE
+ */
+int inputlog_read (void *arg, y86_iotrap_t trap, int *value);
+
+/**
+ * @brief Rewind hook (rewind_hook_t) for machine_set_rewind_hook, with the
+ * log as its argument
+ *
+ * When replaying, moves back to the first record at or after the count, so
+ * the undone traps are fed the same values again. A recording cannot go
+ * back, since standard input has already been read.
+ *
+ * @param m Machine being rewound
+ * @param arg The log
+ * @param count Instruction count the machine goes back to
+ * @returns True if replaying
+ */
+bool inputlog_rewind (machine_t *m, void *arg, uint64_t count);
+
+/**
+ * @brief Finish the log, writing the file if recording
+ *
+ * @param l Log to close
+ * @returns False if the recording could not be written
+ */
+bool inputlog_close (inputlog_t *l);
+
+/**
+ * @brief Print the number of values recorded or replayed, or where the
+ * program stopped following the log
+ *
+ * @param l Closed log
+ */
+void dump_inputlog (inputlog_t *l);
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * CS 261: Undo journal for reverse execution
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "journal.h"
+
+void undo(undo_entry_t *e, y86_t *cpu, byte_t *memory);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool journal_init (journal_t *j, const char *spec)
+{
+    long window = JOURNAL_WINDOW;
+    long every = 0;
+
+    // check for bad parameters
+    if (j == NULL) {
+        return false;
+    }
+
+    memset(j, 0x00, sizeof(journal_t));
+
+    // note where each field ended, so nothing may follow the last one
+    if (spec != NULL) {
+        int ends[2] = { 0, 0 };
+        int fields = sscanf(spec, "%ld%n:%ld%n", &window, &ends[0], &every,
+                &ends[1]);
+        if (fields < 1 || spec[ends[fields - 1]] != '\0') {
+            return false;
+        }
+    }
+    if (every == 0) {
+        every = window / JOURNAL_SNAPSHOTS > 0 ? window / JOURNAL_SNAPSHOTS : 1;
+    }
+    if (window < 1 || every < 1 || every > window) {
+        return false;
+    }
+
+    // enough snapshots to cover the whole window, plus the one being replaced
+    j->window = window;
+    j->snap_every = every;
+    j->nsnaps = window / every + 2;
+    j->entries = (undo_entry_t*)calloc(window, sizeof(undo_entry_t));
+    j->snaps = (journal_snap_t*)calloc(j->nsnaps, sizeof(journal_snap_t));
+    if (j->entries == NULL || j->snaps == NULL) {
+        journal_free(j);
+        return false;
+    }
+
+    return true;
+}
+
+void journal_free (journal_t *j)
+{
+    free(j->entries);
+    free(j->snaps);
+    memset(j, 0x00, sizeof(journal_t));
+}
+
+void journal_reset (journal_t *j, uint64_t count)
+{
+    j->base = count;
+    j->newest = count;
+    j->cur = NULL;
+    for (int i = 0; i < j->nsnaps; i++) {
+        j->snaps[i].valid = false;
+    }
+}
+
+void journal_begin (journal_t *j, y86_t *cpu, y86_inst_t *inst, uint64_t count)
+{
+    undo_entry_t *e = &j->entries[count % j->window];
+
+    e->pc = cpu->pc;
+    e->flags = cpu->zf | (cpu->sf << 1) | (cpu->of << 2);
+    e->reg[0] = NOREG;
+    e->reg[1] = NOREG;
+    e->mem_size = 0;
+    e->input = inst->icode == IOTRAP
+        && (inst->ifun.trap == CHARIN || inst->ifun.trap == DECIN);
+
+    // registers the instruction may write (whether or not it does)
+    switch (inst->icode) {
+        case CMOV:
+        case IRMOVQ:
+        case OPQ:
+            e->reg[0] = inst->rb;
+            break;
+        case MRMOVQ:
+            e->reg[0] = inst->ra;
+            break;
+        case POPQ:
+            e->reg[0] = inst->ra;
+            e->reg[1] = RSP;
+            break;
+        case PUSHQ:
+        case CALL:
+        case RET:
+            e->reg[0] = RSP;
+            break;
+        default:
+            break;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (e->reg[i] < NUMREGS) {
+            e->reg_old[i] = cpu->reg[e->reg[i]];
+        } else {
+            e->reg[i] = NOREG;
+        }
+    }
+
+    j->cur = e;
+    j->newest = count + 1;
+}
+
+void journal_store (journal_t *j, address_t addr, uint64_t old, size_t size)
+{
+    // an instruction stores at most once
+    if (j->cur != NULL && j->cur->mem_size == 0) {
+        j->cur->mem_addr = addr;
+        j->cur->mem_old = old;
+        j->cur->mem_size = size;
+    }
+}
+
+void journal_end (journal_t *j, y86_t *cpu, byte_t *memory, uint64_t count)
+{
+    j->cur = NULL;
+
+    if (count % j->snap_every == 0) {
+        journal_snap_t *snap = &j->snaps[(count / j->snap_every) % j->nsnaps];
+        snap->count = count;
+        snap->valid = true;
+        snap->cpu = *cpu;
+        memcpy(snap->memory, memory, MEMSIZE);
+    }
+}
+
+uint64_t journal_oldest (journal_t *j)
+{
+    if (j->newest - j->base > j->window) {
+        return j->newest - j->window;
+    }
+    return j->base;
+}
+
+bool journal_covers (journal_t *j, uint64_t count, uint64_t target)
+{
+    return target <= count && target >= journal_oldest(j) && count <= j->newest;
+}
+
+bool journal_crosses_input (journal_t *j, uint64_t count, uint64_t target)
+{
+    for (uint64_t c = target; c < count; c++) {
+        if (j->entries[c % j->window].input) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool journal_rewind (journal_t *j, y86_t *cpu, byte_t *memory,
+        uint64_t *count, uint64_t target)
+{
+    if (!journal_covers(j, *count, target)) {
+        return false;
+    }
+
+    // start from the closest snapshot between the target and now, if any
+    journal_snap_t *best = NULL;
+    for (int i = 0; i < j->nsnaps; i++) {
+        journal_snap_t *snap = &j->snaps[i];
+        if (snap->valid && snap->count >= target && snap->count < *count
+              && (best == NULL || snap->count < best->count)) {
+            best = snap;
+        }
+    }
+
+    uint64_t c = *count;
+    if (best != NULL) {
+        *cpu = best->cpu;
+        memcpy(memory, best->memory, MEMSIZE);
+        c = best->count;
+    }
+
+    for (; c > target; c--) {
+        undo(&j->entries[(c - 1) % j->window], cpu, memory);
+    }
+
+    // history past the target no longer describes where the run will go
+    for (int i = 0; i < j->nsnaps; i++) {
+        if (j->snaps[i].count > target) {
+            j->snaps[i].valid = false;
+        }
+    }
+    j->newest = target;
+    *count = target;
+
+    return true;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * put back everything one instruction overwrote
+ */
+void undo(undo_entry_t *e, y86_t *cpu, byte_t *memory)
+{
+    for (int i = 1; i >= 0; i--) {
+        if (e->reg[i] != NOREG) {
+            cpu->reg[e->reg[i]] = e->reg_old[i];
+        }
+    }
+    for (int i = 0; i < e->mem_size && e->mem_addr + i < MEMSIZE; i++) {
+        memory[e->mem_addr + i] = (e->mem_old >> (8 * i)) & 0xff;
+    }
+
+    cpu->pc = e->pc;
+    cpu->zf = e->flags & 1;
+    cpu->sf = (e->flags >> 1) & 1;
+    cpu->of = (e->flags >> 2) & 1;
+    cpu->stat = AOK;
+}
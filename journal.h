@@ -0,0 +1,160 @@
+#ifndef __CS261_JOURNAL__
+#define __CS261_JOURNAL__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "y86.h"
+
+/* defaults for the journal window and snapshot interval */
+#define JOURNAL_WINDOW 100000
+#define JOURNAL_SNAPSHOTS 16
+
+/* what one instruction overwrote, enough to undo it */
+typedef struct undo_entry {
+
+    address_t pc;               // PC before the instruction
+    y86_reg_t reg_old[2];       // previous values of the written registers
+    byte_t reg[2];              // registers written (NOREG if unused)
+    byte_t flags;               // zf | sf << 1 | of << 2 before the instruction
+    byte_t mem_size;            // bytes of memory overwritten (0 for none)
+    bool input;                 // the instruction is a CHARIN or DECIN trap
+    address_t mem_addr;         // address of the overwritten memory
+    uint64_t mem_old;           // previous contents, little-endian
+
+} undo_entry_t;
+
+/* full copy of the machine at one instruction count */
+typedef struct journal_snap {
+
+    uint64_t count;             // instruction count of the copy
+    bool valid;
+    y86_t cpu;
+    byte_t memory[MEMSIZE];
+
+} journal_snap_t;
+
+/* undo journal: a ring of per-instruction entries covering the last
+   `window` instructions, plus full snapshots every `snap_every`
+   instructions so long backward jumps undo at most that many entries */
+typedef struct journal {
+
+    undo_entry_t *entries;      // ring indexed by instruction number % window
+    uint64_t window;
+    uint64_t newest;            // count after the newest recorded instruction
+    uint64_t base;              // count when recording started
+
+    journal_snap_t *snaps;      // ring of snapshots, by count / snap_every
+    int nsnaps;
+    uint64_t snap_every;
+
+    undo_entry_t *cur;          // entry of the executing instruction
+
+} journal_t;
+
+/**
+ * @brief Allocate a journal from a command-line specification
+ *
+ * The specification has the form window[:snapshot-interval]; the interval
+ * defaults to window / JOURNAL_SNAPSHOTS.
+ *
+ * @param j Journal to initialize
+ * @param spec Journal specification string (NULL for the defaults)
+ * @returns True if the specification was valid and the journal allocated
+ */
+bool journal_init (journal_t *j, const char *spec);
+
+/**
+ * @brief Release a journal
+ *
+ * @param j Journal to free
+ */
+void journal_free (journal_t *j);
+
+/**
+ * @brief Forget all history and start recording at the given count
+ *
+ * @param j Journal to reset
+ * @param count Current instruction count
+ */
+void journal_reset (journal_t *j, uint64_t count);
+
+/**
+ * @brief Record the state an instruction is about to overwrite
+ *
+ * @param j Journal to record into
+ * @param cpu CPU state before the instruction executes
+ * @param inst Instruction about to execute
+ * @param count Instruction count before the instruction
+ */
+void journal_begin (journal_t *j, y86_t *cpu, y86_inst_t *inst, uint64_t count);
+
+/**
+ * @brief Record memory overwritten by the executing instruction
+ *
+ * @param j Journal to record into
+ * @param addr First address written
+ * @param old Previous contents of the written bytes
+ * @param size Number of bytes written
+ */
+void journal_store (journal_t *j, address_t addr, uint64_t old, size_t size);
+
+/**
+ * @brief Take a snapshot if the count is on the snapshot interval
+ *
+ * @param j Journal to record into
+ * @param cpu CPU state after the instruction
+ * @param memory Guest memory after the instruction
+ * @param count Instruction count after the instruction
+ */
+void journal_end (journal_t *j, y86_t *cpu, byte_t *memory, uint64_t count);
+
+/**
+ * @brief Get the earliest instruction count the journal can go back to
+ *
+ * @param j Journal to inspect
+ * @returns Lowest reachable instruction count
+ */
+uint64_t journal_oldest (journal_t *j);
+
+/**
+ * @brief Check whether the journal can go back from one count to another
+ *
+ * @param j Journal to inspect
+ * @param count Current instruction count
+ * @param target Instruction count to go back to
+ * @returns True if journal_rewind would reach the target
+ */
+bool journal_covers (journal_t *j, uint64_t count, uint64_t target);
+
+/**
+ * @brief Check whether going back to a count undoes an input trap
+ *
+ * @param j Journal to inspect (covering count back to target)
+ * @param count Current instruction count
+ * @param target Instruction count to go back to
+ * @returns True if a CHARIN or DECIN trap ran from target up to count
+ */
+bool journal_crosses_input (journal_t *j, uint64_t count, uint64_t target);
+
+/**
+ * @brief Move the machine state back to an earlier instruction count
+ *
+ * Starts from the nearest snapshot at or after the target (or from the
+ * current state) and undoes entries down to it. Later history is dropped,
+ * since running forward again may take a different path.
+ *
+ * @param j Journal to use
+ * @param cpu CPU state to rewind
+ * @param memory Guest memory to rewind
+ * @param count In: current instruction count; out: the target
+ * @param target Instruction count to go back to
+ * @returns False if the target is outside the journal window
+ */
+bool journal_rewind (journal_t *j, y86_t *cpu, byte_t *memory,
+        uint64_t *count, uint64_t target);
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * CS 261: Lockstep differential testing
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "lockstep.h"
+
+/* per-thread memory hooks, set aside while the reference engine runs */
+typedef struct lockstep_tls {
+
+    mem_hook_t mem_hook;
+    void *mem_arg;
+    store_hook_t store_hook;
+    void *store_arg;
+    watch_hook_t watch_hook;
+    void *watch_arg;
+    uint64_t dirty[DIRTY_WORDS];
+    FILE *out;
+
+} lockstep_tls_t;
+
+uint64_t lockstep_reference(lockstep_t *ls, uint64_t max, bool blocks);
+bool lockstep_input_next(lockstep_t *ls);
+void lockstep_mirror_input(lockstep_t *ls, machine_t *m);
+bool lockstep_same(lockstep_t *ls, machine_t *m, bool all);
+void lockstep_agree(lockstep_t *ls, machine_t *m);
+void lockstep_restore(lockstep_t *ls, machine_t *m);
+void lockstep_advance(lockstep_t *ls, machine_t *m, uint64_t steps);
+void lockstep_bisect(lockstep_t *ls, machine_t *m, uint64_t steps);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool lockstep_init (lockstep_t *ls, const char *spec, machine_t *m)
+{
+    // check for bad parameters
+    if (ls == NULL || spec == NULL || m == NULL) {
+        return false;
+    }
+
+    memset(ls, 0x00, sizeof(lockstep_t));
+    if (strcmp(spec, "block") != 0) {
+        char *end;
+        if (*spec < '0' || *spec > '9') {
+            return false;
+        }
+        ls->every = strtoull(spec, &end, 10);
+        if (*end != '\0' || ls->every == 0) {
+            return false;
+        }
+    }
+
+    ls->null = fopen("/dev/null", "w");
+    if (ls->null == NULL) {
+        return false;
+    }
+
+    // both engines start from the machine as it is
+    ls->cpu = m->cpu;
+    memcpy(ls->memory, m->memory, MEMSIZE);
+    ls->count = m->count;
+    ls->good_cpu = m->cpu;
+    memcpy(ls->good_memory, m->memory, MEMSIZE);
+    ls->good_count = m->count;
+    memcpy(ls->machine_dirty, m->dirty, sizeof(ls->machine_dirty));
+    machine_clear_dirty(m);
+
+    return true;
+}
+
+bool lockstep_run (lockstep_t *ls, machine_t *m)
+{
+    while (machine_running(m) && !ls->diverged) {
+
+        // the reference runs first and decides how far the machine goes
+        uint64_t max = UINT64_MAX;
+        if (ls->every > 0) {
+            max = ls->every - ls->count % ls->every;
+        }
+        if (m->limit > 0 && m->limit - m->count < max) {
+            max = m->limit - m->count;
+        }
+
+        // an input trap leaves both engines in the same state by construction
+        uint64_t steps = lockstep_reference(ls, max, ls->every == 0);
+        if (steps == 0 && lockstep_input_next(ls)) {
+            lockstep_mirror_input(ls, m);
+            lockstep_agree(ls, m);
+            continue;
+        } else if (steps == 0) {
+            break;
+        }
+        machine_run(m, steps);
+
+        // a limit that stopped the machine part way leaves nothing to compare
+        if (m->count != ls->count && m->stop != STOP_NONE) {
+            break;
+        }
+
+        if (lockstep_same(ls, m, false)) {
+            lockstep_agree(ls, m);
+        } else {
+            lockstep_bisect(ls, m, steps);
+            ls->diverged = true;
+        }
+    }
+
+    // hand the machine back everything it wrote
+    for (int i = 0; i < DIRTY_WORDS; i++) {
+        m->dirty[i] |= ls->machine_dirty[i];
+    }
+
+    return !ls->diverged;
+}
+
+void dump_lockstep (lockstep_t *ls, machine_t *m)
+{
+    if (!ls->diverged) {
+        printf("Lockstep: %" PRIu64 " checks against the reference engine, "
+                "no divergence", ls->checks);
+        if (ls->mirrored > 0) {
+            printf(" (%" PRIu64 " input traps copied)", ls->mirrored);
+        }
+        printf("\n");
+        return;
+    }
+
+    printf("Lockstep: engines diverged at instruction %" PRIu64 "\n", ls->count);
+    if (!ls->repeatable) {
+        printf("  (not repeatable: replaying from instruction %" PRIu64
+                " gave matching states; the culprit is only a guess)\n",
+                ls->good_count);
+    }
+    printf("  %04lx: ", ls->culprit_pc);
+    if (ls->culprit.icode == INVALID) {
+        printf("invalid instruction\n");
+    } else {
+        disassemble(ls->culprit);
+        printf("\n");
+    }
+
+    printf("Reference engine after %" PRIu64 " instructions:\n", ls->count);
+    dump_cpu_state(ls->cpu);
+    printf("Machine after %" PRIu64 " instructions:\n", m->count);
+    dump_cpu_state(m->cpu);
+
+    // the first few differing ranges of memory
+    size_t start = 0;
+    size_t end;
+    int ranges = 0;
+    while (ranges < LOCKSTEP_MAX_RANGES
+            && memdiff_next(ls->memory, m->memory, MEMSIZE, &start, &end)) {
+        if (ranges++ == 0) {
+            printf("Differing memory:\n");
+        }
+        printf("  %04lx-%04lx (%zu bytes)\n", start, end, end - start);
+        for (size_t row = start; row < end; row += 16) {
+            size_t n = end - row < 16 ? end - row : 16;
+            printf("    %04lx  reference ", row);
+            memdiff_row(&ls->memory[row], n);
+            printf("          machine   ");
+            memdiff_row(&m->memory[row], n);
+        }
+        start = end;
+    }
+}
+
+void lockstep_free (lockstep_t *ls)
+{
+    if (ls->null != NULL) {
+        fclose(ls->null);
+        ls->null = NULL;
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * run the reference engine for up to max fetches, stopping after a jump, call
+ * or return if blocks is set, and before any input trap; returns the number
+ * of fetches, counting one that failed
+ */
+uint64_t lockstep_reference(lockstep_t *ls, uint64_t max, bool blocks)
+{
+    y86_t *cpu = &ls->cpu;
+    uint64_t steps = 0;
+
+    // the reference is not instrumented and its output is thrown away
+    lockstep_tls_t saved = {
+        .mem_hook = mem_hook, .mem_arg = mem_hook_arg,
+        .store_hook = store_hook, .store_arg = store_hook_arg,
+        .watch_hook = watch_hook, .watch_arg = watch_hook_arg,
+        .out = iotrap_out
+    };
+    memcpy(saved.dirty, mem_dirty, sizeof(mem_dirty));
+    set_mem_hook(NULL, NULL);
+    set_store_hook(NULL, NULL);
+    set_watch_hook(NULL, NULL);
+    memcpy(mem_dirty, ls->dirty, sizeof(mem_dirty));
+    set_iotrap_out(ls->null);
+
+    while (steps < max && cpu->stat == AOK && !lockstep_input_next(ls)) {
+        bool cnd = false;
+        y86_reg_t valA = 0;
+        y86_reg_t valE = 0;
+
+        y86_inst_t inst = fetch(cpu, ls->memory);
+        steps++;
+        if (cpu->stat == AOK) {
+            valE = decode_execute(cpu, inst, &cnd, &valA);
+            memory_wb_pc(cpu, inst, ls->memory, cnd, valA, valE);
+            ls->count++;
+        }
+
+        // increment pc if status became ADR between decode and pc steps
+        if (cpu->stat == ADR) {
+            cpu->pc += 10;
+        }
+        if (cpu->pc >= MEMSIZE) {
+            cpu->stat = ADR;
+        }
+
+        if (blocks && (inst.icode == JUMP || inst.icode == CALL
+                || inst.icode == RET)) {
+            break;
+        }
+    }
+
+    set_iotrap_out(saved.out);
+    memcpy(ls->dirty, mem_dirty, sizeof(mem_dirty));
+    memcpy(mem_dirty, saved.dirty, sizeof(mem_dirty));
+    set_mem_hook(saved.mem_hook, saved.mem_arg);
+    set_store_hook(saved.store_hook, saved.store_arg);
+    set_watch_hook(saved.watch_hook, saved.watch_arg);
+
+    return steps;
+}
+
+/**
+ * the reference is about to execute a trap that reads input
+ */
+bool lockstep_input_next(lockstep_t *ls)
+{
+    if (ls->cpu.stat != AOK || ls->cpu.pc >= MEMSIZE) {
+        return false;
+    }
+    byte_t op = ls->memory[ls->cpu.pc];
+    return op == ((IOTRAP << 4) | CHARIN) || op == ((IOTRAP << 4) | DECIN);
+}
+
+/**
+ * execute an input trap on the machine only, then give the reference the
+ * same result; iotrap() writes nothing but memory[RDI] and the CPU
+ */
+void lockstep_mirror_input(lockstep_t *ls, machine_t *m)
+{
+    machine_step(m);
+
+    ls->cpu = m->cpu;
+    ls->count = m->count;
+    if (ls->memory[RDI] != m->memory[RDI]) {
+        ls->memory[RDI] = m->memory[RDI];
+        ls->dirty[(RDI >> DIRTY_SHIFT) / 64] |= 1ULL << ((RDI >> DIRTY_SHIFT) % 64);
+    }
+    ls->mirrored++;
+}
+
+/**
+ * the engines are in the same state; memory is compared in full if all is
+ * set, otherwise only where either stored since the last check
+ */
+bool lockstep_same(lockstep_t *ls, machine_t *m, bool all)
+{
+    y86_t *a = &ls->cpu;
+    y86_t *b = &m->cpu;
+
+    if (ls->count != m->count || a->pc != b->pc || a->stat != b->stat
+          || a->zf != b->zf || a->sf != b->sf || a->of != b->of
+          || memcmp(a->reg, b->reg, sizeof(a->reg)) != 0) {
+        return false;
+    }
+    if (all) {
+        return memcmp(ls->memory, m->memory, MEMSIZE) == 0;
+    }
+
+    for (int i = 0; i < DIRTY_WORDS; i++) {
+        uint64_t bits = ls->dirty[i] | m->dirty[i];
+        while (bits != 0) {
+            address_t addr = (i * 64 + __builtin_ctzll(bits)) << DIRTY_SHIFT;
+            bits &= bits - 1;
+            if (memcmp(&ls->memory[addr], &m->memory[addr], DIRTY_REGION) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * record the state both engines reached as the new base for bisection, and
+ * start the next stretch with clean dirty bitmaps
+ */
+void lockstep_agree(lockstep_t *ls, machine_t *m)
+{
+    for (int i = 0; i < DIRTY_WORDS; i++) {
+        uint64_t bits = ls->dirty[i] | m->dirty[i];
+        while (bits != 0) {
+            address_t addr = (i * 64 + __builtin_ctzll(bits)) << DIRTY_SHIFT;
+            bits &= bits - 1;
+            memcpy(&ls->good_memory[addr], &ls->memory[addr], DIRTY_REGION);
+        }
+        ls->machine_dirty[i] |= m->dirty[i];
+    }
+    ls->good_cpu = ls->cpu;
+    ls->good_count = ls->count;
+
+    memset(ls->dirty, 0x00, sizeof(ls->dirty));
+    machine_clear_dirty(m);
+    ls->checks++;
+}
+
+/**
+ * put both engines back in the last state they agreed on
+ */
+void lockstep_restore(lockstep_t *ls, machine_t *m)
+{
+    ls->cpu = ls->good_cpu;
+    memcpy(ls->memory, ls->good_memory, MEMSIZE);
+    ls->count = ls->good_count;
+    memset(ls->dirty, 0x00, sizeof(ls->dirty));
+
+    m->cpu = ls->good_cpu;
+    memcpy(m->memory, ls->good_memory, MEMSIZE);
+    m->count = ls->good_count;
+    m->stop = STOP_NONE;
+    machine_mark_dirty(m, 0, MEMSIZE);
+}
+
+/**
+ * move both engines forward by the same number of fetches
+ */
+void lockstep_advance(lockstep_t *ls, machine_t *m, uint64_t steps)
+{
+    if (steps > 0) {
+        lockstep_reference(ls, steps, false);
+        machine_run(m, steps);
+    }
+}
+
+/**
+ * find the first of steps fetches after the agreed state whose results
+ * differ, and leave both engines just after it; the guest's output is
+ * thrown away while stretches are repeated
+ */
+void lockstep_bisect(lockstep_t *ls, machine_t *m, uint64_t steps)
+{
+    FILE *out = iotrap_out;
+    set_iotrap_out(ls->null);
+
+    // the engines agree after lo fetches and differ after hi
+    uint64_t lo = 0;
+    uint64_t hi = steps;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        lockstep_restore(ls, m);
+        lockstep_advance(ls, m, mid);
+        if (lockstep_same(ls, m, true)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    lockstep_restore(ls, m);
+    lockstep_advance(ls, m, hi - 1);
+
+    // decode the culprit without disturbing the reference or the access hook
+    y86_t cpu = ls->cpu;
+    mem_hook_t hook = mem_hook;
+    void *arg = mem_hook_arg;
+    set_mem_hook(NULL, NULL);
+    ls->culprit_pc = cpu.pc;
+    ls->culprit = fetch(&cpu, ls->memory);
+    set_mem_hook(hook, arg);
+    if (cpu.stat != AOK) {
+        ls->culprit.icode = INVALID;
+    }
+
+    lockstep_advance(ls, m, 1);
+    ls->repeatable = !lockstep_same(ls, m, true);
+    set_iotrap_out(out);
+}
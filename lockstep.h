@@ -0,0 +1,100 @@
+#ifndef __CS261_LOCKSTEP__
+#define __CS261_LOCKSTEP__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "memdiff.h"
+#include "memhook.h"
+#include "p3-disas.h"
+#include "p4-interp.h"
+#include "y86.h"
+
+/* differing memory ranges printed when the engines diverge */
+#define LOCKSTEP_MAX_RANGES 8
+
+/* differential run of a machine against the reference engine: the plain
+   fetch(), decode_execute() and memory_wb_pc() loop on its own copy of
+   memory. The reference runs each stretch first (a basic block, or every
+   instructions), then the machine runs the same number with machine_run and
+   the two are compared. Only memory either engine stored to since the last
+   check is compared. */
+typedef struct lockstep {
+
+    uint64_t every;             // instructions per check, 0 for each block
+
+    // the reference engine
+    y86_t cpu;
+    byte_t memory[MEMSIZE];
+    uint64_t count;
+    uint64_t dirty[DIRTY_WORDS];        // regions it stored to since the check
+    FILE *null;                         // its guest output goes here
+
+    // regions the machine stored to before the last check; the machine's own
+    // bitmap is cleared at each check and these are put back at the end
+    uint64_t machine_dirty[DIRTY_WORDS];
+
+    // the last state both engines agreed on
+    y86_t good_cpu;
+    byte_t good_memory[MEMSIZE];
+    uint64_t good_count;
+
+    uint64_t checks;            // comparisons that matched
+    uint64_t mirrored;          // input traps only the machine executed
+    bool diverged;
+    y86_inst_t culprit;         // first instruction whose results differ
+    address_t culprit_pc;
+    bool repeatable;            // replaying the stretch diverged again
+
+} lockstep_t;
+
+/**
+ * @brief Start a differential run from the machine's current state
+ *
+ * @param ls Run to initialize
+ * @param spec "block" to check at the end of every basic block, or the
+ *        number of instructions between checks
+ * @param m Machine to check (loaded, or restored from a checkpoint)
+ * @returns False if the specification is invalid or /dev/null cannot be
+ *          opened
+ */
+bool lockstep_init (lockstep_t *ls, const char *spec, machine_t *m);
+
+/**
+ * @brief Run the machine and the reference engine until the program stops,
+ * a limit stops the machine or the two diverge
+ *
+ * On divergence both engines are taken back to the last state they agreed
+ * on and moved forward again in halving steps, so they are left just after
+ * the first instruction whose results differ; this assumes both engines are
+ * deterministic, and a divergence that does not repeat is reported as such.
+ * Input traps (CHARIN and DECIN) are executed by the machine alone and copied
+ * to the reference, so input is read once.
+ *
+ * @param ls Run state from lockstep_init
+ * @param m Machine to check
+ * @returns False if the engines diverged
+ */
+bool lockstep_run (lockstep_t *ls, machine_t *m);
+
+/**
+ * @brief Print the outcome: the number of checks, or the first differing
+ * instruction with both engines' states and differing memory
+ *
+ * @param ls Finished run
+ * @param m Machine that was checked
+ */
+void dump_lockstep (lockstep_t *ls, machine_t *m);
+
+/**
+ * @brief Release the run
+ *
+ * @param ls Run to free
+ */
+void lockstep_free (lockstep_t *ls);
+
+#endif
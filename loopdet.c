@@ -0,0 +1,129 @@
+/*
+ * CS 261: Infinite-loop detection
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "loopdet.h"
+
+uint64_t hash_mix(uint64_t x);
+uint64_t byte_hash(address_t addr, byte_t b);
+uint64_t state_hash(loopdet_t *ld, y86_t *cpu);
+bool same_state(loopdet_t *ld, y86_t *cpu, byte_t *memory);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+void loopdet_reset (loopdet_t *ld, byte_t *memory)
+{
+    ld->mem_hash = 0;
+    for (address_t a = 0; a < MEMSIZE; a++) {
+        ld->mem_hash ^= byte_hash(a, memory[a]);
+    }
+    ld->checks = 0;
+    loopdet_forget(ld);
+}
+
+void loopdet_forget (loopdet_t *ld)
+{
+    ld->saved = false;
+    ld->power = 1;
+    ld->lam = 0;
+}
+
+void loopdet_store (void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size)
+{
+    loopdet_t *ld = (loopdet_t*)arg;
+
+    // swap each changed byte's contribution; stores past the end are ignored
+    for (size_t i = 0; i < size && addr + i < MEMSIZE; i++) {
+        byte_t before = (old >> (8 * i)) & 0xff;
+        byte_t after = (val >> (8 * i)) & 0xff;
+        if (before != after) {
+            ld->mem_hash ^= byte_hash(addr + i, before) ^ byte_hash(addr + i, after);
+        }
+    }
+}
+
+bool loopdet_check (loopdet_t *ld, y86_t *cpu, byte_t *memory)
+{
+    uint64_t hash = state_hash(ld, cpu);
+
+    ld->checks++;
+    if (ld->saved && hash == ld->saved_hash && same_state(ld, cpu, memory)) {
+        return true;
+    }
+
+    // Brent: move the saved state forward at doubling intervals so any
+    // cycle is found within about twice its length
+    if (!ld->saved || ++ld->lam == ld->power) {
+        ld->saved = true;
+        ld->saved_hash = hash;
+        ld->saved_cpu = *cpu;
+        memcpy(ld->saved_memory, memory, MEMSIZE);
+        ld->power *= 2;
+        ld->lam = 0;
+    }
+
+    return false;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * splitmix64 finalizer
+ */
+uint64_t hash_mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * contribution of one memory byte to the memory hash
+ */
+uint64_t byte_hash(address_t addr, byte_t b)
+{
+    return hash_mix((addr << 8) | b);
+}
+
+/**
+ * combine the CPU state with the memory hash (the registers are few enough
+ * to hash at each check)
+ */
+uint64_t state_hash(loopdet_t *ld, y86_t *cpu)
+{
+    uint64_t h = ld->mem_hash;
+
+    for (int i = 0; i < NUMREGS; i++) {
+        h = hash_mix(h ^ cpu->reg[i]);
+    }
+    h = hash_mix(h ^ cpu->pc);
+    h = hash_mix(h ^ (cpu->zf | (cpu->sf << 1) | (cpu->of << 2)));
+
+    return h;
+}
+
+/**
+ * compare the current state with the saved copy
+ */
+bool same_state(loopdet_t *ld, y86_t *cpu, byte_t *memory)
+{
+    y86_t *saved = &ld->saved_cpu;
+
+    if (cpu->pc != saved->pc || cpu->zf != saved->zf || cpu->sf != saved->sf
+          || cpu->of != saved->of) {
+        return false;
+    }
+    if (memcmp(cpu->reg, saved->reg, sizeof(cpu->reg)) != 0) {
+        return false;
+    }
+
+    return memcmp(memory, ld->saved_memory, MEMSIZE) == 0;
+}
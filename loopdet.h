@@ -0,0 +1,71 @@
+#ifndef __CS261_LOOPDET__
+#define __CS261_LOOPDET__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memhook.h"
+#include "y86.h"
+
+/* infinite-loop detector: a hash of guest memory kept up to date on every
+   store, combined with the CPU state at backward jumps and compared against
+   a saved state with Brent's cycle-finding schedule */
+typedef struct loopdet {
+
+    uint64_t mem_hash;          // XOR of a per-(address, byte) hash over memory
+    uint64_t checks;            // states compared so far
+
+    bool saved;                 // a state has been saved for comparison
+    uint64_t saved_hash;        // hash of the saved state
+    y86_t saved_cpu;            // saved state, to confirm a hash match
+    byte_t saved_memory[MEMSIZE];
+    uint64_t power;             // checks before the saved state is replaced
+    uint64_t lam;               // checks since the saved state was taken
+
+} loopdet_t;
+
+/**
+ * @brief Hash the whole address space and forget any saved state
+ *
+ * @param ld Detector to reset
+ * @param memory Guest memory in its current state
+ */
+void loopdet_reset (loopdet_t *ld, byte_t *memory);
+
+/**
+ * @brief Forget the saved state, e.g. after input that makes a repeated state
+ * no longer mean a loop
+ *
+ * @param ld Detector to use
+ */
+void loopdet_forget (loopdet_t *ld);
+
+/**
+ * @brief Store hook that folds a guest store into the memory hash
+ *
+ * @param arg Detector to update
+ * @param addr First guest address written
+ * @param old Previous contents of the written bytes
+ * @param val New contents of the written bytes
+ * @param size Number of bytes written
+ */
+void loopdet_store (void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size);
+
+/**
+ * @brief Compare the current state with the saved one
+ *
+ * Call at backward jumps. A hash match is confirmed against the saved copy,
+ * so a reported loop is never a hash collision.
+ *
+ * @param ld Detector to use
+ * @param cpu Current CPU state
+ * @param memory Current guest memory
+ * @returns True if the machine is in exactly a state it was in before
+ */
+bool loopdet_check (loopdet_t *ld, y86_t *cpu, byte_t *memory);
+
+#endif
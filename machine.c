@@ -0,0 +1,760 @@
+/*
+ * CS 261: In-process execution API
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "machine.h"
+
+/* store-path state of the calling thread, set aside while a machine runs */
+typedef struct machine_tls {
+
+    store_hook_t hook;
+    void *arg;
+    uint64_t dirty[DIRTY_WORDS];
+    watch_hook_t watch_hook;
+    void *watch_arg;
+    uint64_t watched[WATCH_WORDS];
+
+} machine_tls_t;
+
+static inline y86_stat_t machine_exec(machine_t *m, const bool hooked,
+        const bool covered);
+void machine_enter(machine_t *m, machine_tls_t *saved);
+void machine_leave(machine_t *m, machine_tls_t *saved);
+void machine_store(void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size);
+void machine_end_block(machine_t *m);
+void machine_start_clock(machine_t *m);
+bool machine_timed_out(machine_t *m);
+void machine_check_limit(machine_t *m);
+void machine_unpark(machine_t *m);
+void machine_check_loop(machine_t *m, address_t pc, y86_inst_t *inst, bool cnd);
+void machine_index_watches(machine_t *m);
+void machine_watch_hit(void *arg, mem_access_t type, address_t pc,
+        address_t addr, uint64_t old, uint64_t val, size_t size);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+machine_t *machine_create (void)
+{
+    machine_t *m = (machine_t*)calloc(1, sizeof(machine_t));
+    if (m == NULL) {
+        return NULL;
+    }
+
+    m->cpu.stat = AOK;
+    return m;
+}
+
+void machine_destroy (machine_t *m)
+{
+    if (m == NULL) {
+        return;
+    }
+
+    free(m->phdrs);
+    symtab_free(&m->symbols);
+    free(m->loop);
+    free(m->coverage);
+    free(m->watches);
+    if (m->journal != NULL) {
+        journal_free(m->journal);
+        free(m->journal);
+    }
+    free(m);
+}
+
+bool machine_load (machine_t *m, FILE *file)
+{
+    // check for bad parameters
+    if (m == NULL || file == NULL) {
+        return false;
+    }
+
+    // load into scratch copies so a bad image leaves the machine as it was
+    elf_hdr_t hdr;
+    if (!read_header(file, &hdr)) {
+        return false;
+    }
+
+    elf_phdr_t *phdrs = (elf_phdr_t*)calloc(hdr.e_num_phdr + 1, sizeof(elf_phdr_t));
+    if (phdrs == NULL) {
+        return false;
+    }
+
+    // read each program header and load its segment into a clean address space
+    byte_t memory[MEMSIZE];
+    memset(memory, 0x00, MEMSIZE);
+    for (int i = 0; i < hdr.e_num_phdr; i++) {
+        int offset = hdr.e_phdr_start + (i * sizeof(elf_phdr_t));
+        if (!read_phdr(file, offset, &phdrs[i])
+              || !load_segment(file, memory, phdrs[i])) {
+            free(phdrs);
+            return false;
+        }
+    }
+
+    // a missing or malformed symbol table only leaves the image unnamed
+    symtab_t symbols;
+    memset(&symbols, 0x00, sizeof(symtab_t));
+    if (!symtab_load(&symbols, file, &hdr)) {
+        free(phdrs);
+        return false;
+    }
+
+    // commit the new image; every byte of memory is replaced, so the reset
+    // only has to clear the dirty marks
+    m->hdr = hdr;
+    free(m->phdrs);
+    m->phdrs = phdrs;
+    symtab_free(&m->symbols);
+    m->symbols = symbols;
+    memcpy(m->image, memory, MEMSIZE);
+    memcpy(m->memory, memory, MEMSIZE);
+    machine_reset(m);
+
+    return true;
+}
+
+bool machine_load_file (machine_t *m, const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = machine_load(m, file);
+    fclose(file);
+
+    return ok;
+}
+
+bool machine_load_buffer (machine_t *m, const byte_t *buf, size_t len)
+{
+    if (buf == NULL || len == 0) {
+        return false;
+    }
+
+    // read through a stream so the loader checks are shared with files
+    FILE *file = fmemopen((void*) buf, len, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = machine_load(m, file);
+    fclose(file);
+
+    return ok;
+}
+
+void machine_reset (machine_t *m)
+{
+    // only the regions the guest wrote can differ from the image
+    address_t start = 0;
+    address_t end;
+    while (machine_next_dirty(m, &start, &end)) {
+        memcpy(&m->memory[start], &m->image[start], end - start);
+        start = end;
+    }
+    machine_clear_dirty(m);
+
+    memset(&m->cpu, 0x00, sizeof(y86_t));
+    m->cpu.stat = AOK;
+    m->cpu.pc = m->hdr.e_entry;
+    m->count = 0;
+    m->stop = STOP_NONE;
+    m->started = false;
+    m->block_insts = 0;
+    if (m->loop != NULL) {
+        loopdet_reset(m->loop, m->memory);
+    }
+    if (m->journal != NULL) {
+        journal_reset(m->journal, 0);
+    }
+}
+
+void machine_set_hooks (machine_t *m, fetch_hook_t fetch, exec_hook_t exec,
+        block_hook_t block, void *arg)
+{
+    m->fetch_hook = fetch;
+    m->exec_hook = exec;
+    m->block_hook = block;
+    m->hook_arg = arg;
+}
+
+void machine_set_store_hook (machine_t *m, store_hook_t hook, void *arg)
+{
+    m->store_fn = hook;
+    m->store_arg = arg;
+}
+
+void machine_set_rewind_hook (machine_t *m, rewind_hook_t hook, void *arg)
+{
+    m->rewind_fn = hook;
+    m->rewind_arg = arg;
+}
+
+void machine_set_limits (machine_t *m, uint64_t insts, double seconds)
+{
+    m->limit = insts;
+    m->timeout = seconds > 0.0 ? seconds : 0.0;
+    m->started = false;
+}
+
+bool machine_next_dirty (machine_t *m, address_t *start, address_t *end)
+{
+    address_t r = *start >> DIRTY_SHIFT;
+
+    // skip clean words, then clean bits
+    while (r < DIRTY_REGIONS && (m->dirty[r / 64] >> (r % 64)) == 0) {
+        r = (r / 64 + 1) * 64;
+    }
+    if (r >= DIRTY_REGIONS) {
+        return false;
+    }
+    r += __builtin_ctzll(m->dirty[r / 64] >> (r % 64));
+    *start = r << DIRTY_SHIFT;
+
+    // extend over the following dirty regions
+    while (r < DIRTY_REGIONS && (m->dirty[r / 64] >> (r % 64)) & 1) {
+        r++;
+    }
+    *end = r << DIRTY_SHIFT;
+
+    return true;
+}
+
+void machine_clear_dirty (machine_t *m)
+{
+    memset(m->dirty, 0x00, sizeof(m->dirty));
+}
+
+void machine_mark_dirty (machine_t *m, address_t addr, size_t size)
+{
+    if (size == 0 || addr >= MEMSIZE) {
+        return;
+    }
+    if (addr + size > MEMSIZE) {
+        size = MEMSIZE - addr;
+    }
+
+    for (address_t r = addr >> DIRTY_SHIFT; r <= (addr + size - 1) >> DIRTY_SHIFT; r++) {
+        m->dirty[r / 64] |= 1ULL << (r % 64);
+    }
+}
+
+bool machine_detect_loops (machine_t *m, bool enable)
+{
+    if (!enable) {
+        free(m->loop);
+        m->loop = NULL;
+        return true;
+    }
+
+    if (m->loop == NULL) {
+        m->loop = (loopdet_t*)malloc(sizeof(loopdet_t));
+        if (m->loop == NULL) {
+            return false;
+        }
+    }
+    loopdet_reset(m->loop, m->memory);
+
+    return true;
+}
+
+bool machine_cover (machine_t *m, bool enable)
+{
+    if (!enable) {
+        free(m->coverage);
+        m->coverage = NULL;
+        return true;
+    }
+
+    if (m->coverage == NULL) {
+        m->coverage = (coverage_t*)calloc(1, sizeof(coverage_t));
+        if (m->coverage == NULL) {
+            return false;
+        }
+    }
+    memset(m->coverage, 0x00, sizeof(coverage_t));
+
+    return true;
+}
+
+bool machine_record (machine_t *m, const char *spec)
+{
+    journal_t *journal = (journal_t*)malloc(sizeof(journal_t));
+    if (journal == NULL) {
+        return false;
+    }
+    if (!journal_init(journal, spec)) {
+        free(journal);
+        return false;
+    }
+
+    if (m->journal != NULL) {
+        journal_free(m->journal);
+        free(m->journal);
+    }
+    m->journal = journal;
+    journal_reset(m->journal, m->count);
+
+    return true;
+}
+
+bool machine_rewind (machine_t *m, uint64_t target)
+{
+    if (m->journal == NULL || !journal_covers(m->journal, m->count, target)) {
+        return false;
+    }
+
+    // undone input traps must read the same values when they run again
+    if (journal_crosses_input(m->journal, m->count, target)
+          && (m->rewind_fn == NULL || !m->rewind_fn(m, m->rewind_arg, target))) {
+        return false;
+    }
+
+    journal_rewind(m->journal, &m->cpu, m->memory, &m->count, target);
+
+    // undone stores may be anywhere, and the run is live again
+    machine_mark_dirty(m, 0, MEMSIZE);
+    m->stop = STOP_NONE;
+    m->block_insts = 0;
+    if (m->loop != NULL) {
+        loopdet_reset(m->loop, m->memory);
+    }
+
+    return true;
+}
+
+bool machine_step_back (machine_t *m)
+{
+    return m->count > 0 && machine_rewind(m, m->count - 1);
+}
+
+bool machine_set_break (machine_t *m, address_t addr, bool on)
+{
+    if (addr >= MEMSIZE) {
+        return false;
+    }
+
+    uint64_t bit = 1ULL << (addr % 64);
+    if (on && !(m->breaks[addr / 64] & bit)) {
+        m->breaks[addr / 64] |= bit;
+        m->nbreaks++;
+    } else if (!on && (m->breaks[addr / 64] & bit)) {
+        m->breaks[addr / 64] &= ~bit;
+        m->nbreaks--;
+    }
+
+    return true;
+}
+
+bool machine_is_break (machine_t *m, address_t addr)
+{
+    return addr < MEMSIZE && (m->breaks[addr / 64] >> (addr % 64)) & 1;
+}
+
+bool machine_watch (machine_t *m, address_t addr, size_t len, bool read,
+        bool write)
+{
+    if (len == 0 || addr >= MEMSIZE || len > MEMSIZE - addr || !(read || write)) {
+        return false;
+    }
+
+    machine_watch_t *watches = (machine_watch_t*)realloc(m->watches,
+            (m->nwatches + 1) * sizeof(machine_watch_t));
+    if (watches == NULL) {
+        return false;
+    }
+    m->watches = watches;
+
+    machine_watch_t *w = &m->watches[m->nwatches++];
+    w->start = addr;
+    w->end = addr + len;
+    w->read = read;
+    w->write = write;
+    machine_index_watches(m);
+
+    return true;
+}
+
+bool machine_unwatch (machine_t *m, address_t addr, size_t len, bool read,
+        bool write)
+{
+    for (int i = 0; i < m->nwatches; i++) {
+        machine_watch_t *w = &m->watches[i];
+        if (w->start == addr && w->end == addr + len && w->read == read
+              && w->write == write) {
+            m->watches[i] = m->watches[--m->nwatches];
+            machine_index_watches(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+y86_stat_t machine_step (machine_t *m)
+{
+    if (!machine_running(m)) {
+        return m->cpu.stat;
+    }
+
+    machine_tls_t saved;
+
+    machine_start_clock(m);
+    machine_enter(m, &saved);
+    machine_exec(m, true, m->coverage != NULL);
+    machine_leave(m, &saved);
+    machine_unpark(m);
+
+    // stop as soon as a limit is reached so callers never see one more step
+    machine_check_limit(m);
+    if (m->count % WATCHDOG_BATCH == 0 && machine_timed_out(m)) {
+        m->stop = STOP_TIMEOUT;
+    }
+
+    return m->cpu.stat;
+}
+
+y86_stat_t machine_run (machine_t *m, uint64_t budget)
+{
+    uint64_t end = (budget == 0) ? UINT64_MAX : m->count + budget;
+    if (m->limit > 0 && m->limit < end) {
+        end = m->limit;
+    }
+
+    // pick the loop once so uninstrumented runs never test the hooks
+    bool hooked = m->fetch_hook != NULL || m->exec_hook != NULL
+        || m->block_hook != NULL || m->loop != NULL || m->journal != NULL
+        || m->nwatches > 0;
+    bool covered = m->coverage != NULL;
+
+    // a run that starts on a breakpoint executes it rather than stopping
+    if (m->nbreaks > 0 && machine_is_break(m, m->cpu.pc) && m->count < end) {
+        machine_step(m);
+    }
+
+    machine_tls_t saved;
+
+    machine_start_clock(m);
+    machine_enter(m, &saved);
+
+    // run in batches so the wall clock is only read between them
+    while (machine_running(m) && m->count < end) {
+        if (machine_timed_out(m)) {
+            m->stop = STOP_TIMEOUT;
+            break;
+        }
+
+        uint64_t batch = end - m->count;
+        if (m->timeout > 0.0 && batch > WATCHDOG_BATCH) {
+            batch = WATCHDOG_BATCH;
+        }
+
+        if (m->nbreaks > 0) {
+            // guest memory is never patched, so the program sees its own
+            // bytes; the cost is one bit test per instruction
+            for (; batch > 0 && machine_running(m); batch--) {
+                if (machine_is_break(m, m->cpu.pc)) {
+                    m->stop = STOP_BREAK;
+                    break;
+                }
+                machine_exec(m, hooked, covered);
+            }
+        } else if (hooked) {
+            for (; batch > 0 && machine_running(m); batch--) {
+                machine_exec(m, true, covered);
+            }
+        } else if (covered) {
+            for (; batch > 0 && m->cpu.stat == AOK; batch--) {
+                machine_exec(m, false, true);
+            }
+        } else {
+            for (; batch > 0 && m->cpu.stat == AOK; batch--) {
+                machine_exec(m, false, false);
+            }
+        }
+    }
+
+    machine_leave(m, &saved);
+    machine_unpark(m);
+    machine_check_limit(m);
+
+    return m->cpu.stat;
+}
+
+void machine_stop (machine_t *m, machine_stop_t why)
+{
+    m->stop = why;
+    if (m->cpu.stat == AOK) {
+        m->cpu.stat = HLT;
+        m->parked = true;
+    }
+}
+
+bool machine_running (machine_t *m)
+{
+    return m->cpu.stat == AOK && m->stop == STOP_NONE;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * fetch, execute and write back one instruction; hooked and covered are
+ * constants at the fast call sites so the uninstrumented copies have no hook
+ * or coverage checks
+ */
+static inline y86_stat_t machine_exec(machine_t *m, const bool hooked,
+        const bool covered)
+{
+    y86_t *cpu = &m->cpu;
+    bool cnd = false;
+    y86_reg_t valA = 0;
+    y86_reg_t valE = 0;
+
+    address_t pc = cpu->pc;
+    y86_inst_t inst = fetch(cpu, m->memory);
+
+    if (hooked && m->fetch_hook != NULL) {
+        m->fetch_hook(m, m->hook_arg, &inst);
+    }
+
+    // only continue if cpu status is AOK
+    if (cpu->stat == AOK) {
+        if (hooked && m->journal != NULL) {
+            journal_begin(m->journal, cpu, &inst, m->count);
+        }
+
+        valE = decode_execute(cpu, inst, &cnd, &valA);
+        memory_wb_pc(cpu, inst, m->memory, cnd, valA, valE);
+        m->count++;
+
+        if (covered) {
+            coverage_mark(m->coverage, pc, &inst, cnd);
+        }
+
+        if (hooked) {
+            if (m->journal != NULL) {
+                journal_end(m->journal, cpu, m->memory, m->count);
+            }
+            if (m->exec_hook != NULL) {
+                m->exec_hook(m, m->hook_arg, pc, &inst, cnd, valA, valE);
+            }
+            if (m->block_insts++ == 0) {
+                m->block_start = pc;
+            }
+            if (inst.icode == JUMP || inst.icode == CALL || inst.icode == RET) {
+                machine_end_block(m);
+            }
+            if (m->loop != NULL) {
+                machine_check_loop(m, pc, &inst, cnd);
+            }
+        }
+    }
+
+    // increment pc if status became ADR between decode and pc steps
+    if (cpu->stat == ADR) {
+        cpu->pc += 10;
+    }
+
+    if (cpu->pc >= MEMSIZE) {
+        cpu->stat = ADR;
+    }
+
+    if (hooked && cpu->stat != AOK) {
+        machine_end_block(m);
+    }
+
+    return cpu->stat;
+}
+
+/**
+ * undo the HLT machine_stop used to end the run, unless the instruction
+ * faulted on its own
+ */
+void machine_unpark(machine_t *m)
+{
+    if (m->parked) {
+        m->parked = false;
+        if (m->cpu.stat == HLT) {
+            m->cpu.stat = AOK;
+        }
+    }
+}
+
+/**
+ * install this machine's store hook and dirty bitmap on the calling thread;
+ * both are per thread, so they are only held for the length of a run
+ */
+void machine_enter(machine_t *m, machine_tls_t *saved)
+{
+    saved->hook = store_hook;
+    saved->arg = store_hook_arg;
+    memcpy(saved->dirty, mem_dirty, sizeof(mem_dirty));
+
+    saved->watch_hook = watch_hook;
+    saved->watch_arg = watch_hook_arg;
+    memcpy(saved->watched, mem_watched, sizeof(mem_watched));
+
+    if (m->loop != NULL || m->journal != NULL || m->store_fn != NULL) {
+        set_store_hook(machine_store, m);
+    }
+    memcpy(mem_dirty, m->dirty, sizeof(mem_dirty));
+    set_watch_hook(machine_watch_hit, m);
+    memcpy(mem_watched, m->watched, sizeof(mem_watched));
+}
+
+/**
+ * take back the dirty bitmap and put the thread's previous state back
+ */
+void machine_leave(machine_t *m, machine_tls_t *saved)
+{
+    memcpy(m->dirty, mem_dirty, sizeof(mem_dirty));
+
+    set_store_hook(saved->hook, saved->arg);
+    memcpy(mem_dirty, saved->dirty, sizeof(mem_dirty));
+    set_watch_hook(saved->watch_hook, saved->watch_arg);
+    memcpy(mem_watched, saved->watched, sizeof(mem_watched));
+}
+
+/**
+ * rebuild the bitmap of pages that hold a watched range; an 8-byte access
+ * starting up to 7 bytes before a range must be caught too
+ */
+void machine_index_watches(machine_t *m)
+{
+    memset(m->watched, 0x00, sizeof(m->watched));
+    for (int i = 0; i < m->nwatches; i++) {
+        address_t start = m->watches[i].start;
+        address_t first = (start < 7 ? 0 : start - 7) >> WATCH_SHIFT;
+        address_t last = (m->watches[i].end - 1) >> WATCH_SHIFT;
+        for (address_t page = first; page <= last; page++) {
+            m->watched[page / 64] |= 1ULL << (page % 64);
+        }
+    }
+}
+
+/**
+ * watch hook: an access touched a watched page, so compare it against the
+ * exact ranges and stop on the first match
+ */
+void machine_watch_hit(void *arg, mem_access_t type, address_t pc,
+        address_t addr, uint64_t old, uint64_t val, size_t size)
+{
+    machine_t *m = (machine_t*)arg;
+
+    if (m->stop == STOP_WATCH) {
+        return;
+    }
+
+    for (int i = 0; i < m->nwatches; i++) {
+        machine_watch_t *w = &m->watches[i];
+        if (addr < w->end && addr + size > w->start
+              && (type == ACCESS_READ ? w->read : w->write)) {
+            m->hit.watch = *w;
+            m->hit.type = type;
+            m->hit.pc = pc;
+            m->hit.addr = addr;
+            m->hit.old = old;
+            m->hit.val = val;
+            m->hit.size = size;
+            m->stop = STOP_WATCH;
+            return;
+        }
+    }
+}
+
+/**
+ * store hook: pass each guest store on to the loop detector, journal and
+ * store observer
+ */
+void machine_store(void *arg, address_t addr, uint64_t old, uint64_t val,
+        size_t size)
+{
+    machine_t *m = (machine_t*)arg;
+
+    if (m->loop != NULL) {
+        loopdet_store(m->loop, addr, old, val, size);
+    }
+    if (m->journal != NULL) {
+        journal_store(m->journal, addr, old, size);
+    }
+    if (m->store_fn != NULL) {
+        m->store_fn(m->store_arg, addr, old, val, size);
+    }
+}
+
+/**
+ * report the current basic block (if any) and start a new one
+ */
+void machine_end_block(machine_t *m)
+{
+    if (m->block_hook != NULL && m->block_insts > 0) {
+        m->block_hook(m, m->hook_arg, m->block_start, m->block_insts);
+    }
+    m->block_insts = 0;
+}
+
+/**
+ * start the wall clock on the first run after a reset
+ */
+void machine_start_clock(machine_t *m)
+{
+    if (m->timeout <= 0.0 || m->started) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &m->deadline);
+    long nsec = m->deadline.tv_nsec + (long) ((m->timeout - (long) m->timeout) * 1e9);
+    m->deadline.tv_sec += (time_t) m->timeout + nsec / 1000000000L;
+    m->deadline.tv_nsec = nsec % 1000000000L;
+    m->started = true;
+}
+
+/**
+ * check whether the wall-clock limit has passed
+ */
+bool machine_timed_out(machine_t *m)
+{
+    if (m->timeout <= 0.0) {
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec > m->deadline.tv_sec || (now.tv_sec == m->deadline.tv_sec
+            && now.tv_nsec >= m->deadline.tv_nsec);
+}
+
+/**
+ * record a budget stop if the instruction limit was reached while the CPU
+ * could still continue
+ */
+void machine_check_limit(machine_t *m)
+{
+    if (m->limit > 0 && m->count >= m->limit && machine_running(m)) {
+        m->stop = STOP_BUDGET;
+    }
+}
+
+/**
+ * compare the state at taken backward jumps and forget it after input
+ */
+void machine_check_loop(machine_t *m, address_t pc, y86_inst_t *inst, bool cnd)
+{
+    if (inst->icode == JUMP && cnd && inst->valC.dest <= pc) {
+        if (m->cpu.stat == AOK && loopdet_check(m->loop, &m->cpu, m->memory)) {
+            m->stop = STOP_LOOP;
+        }
+    } else if (inst->icode == IOTRAP
+          && (inst->ifun.trap == CHARIN || inst->ifun.trap == DECIN)) {
+        loopdet_forget(m->loop);
+    }
+}
@@ -0,0 +1,411 @@
+#ifndef __CS261_MACHINE__
+#define __CS261_MACHINE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "coverage.h"
+#include "elf.h"
+#include "journal.h"
+#include "loopdet.h"
+#include "p1-check.h"
+#include "p2-load.h"
+#include "p3-disas.h"
+#include "p4-interp.h"
+#include "symtab.h"
+#include "y86.h"
+
+/* instructions run between wall-clock checks when a timeout is set */
+#define WATCHDOG_BATCH (1 << 16)
+
+/* why a run was stopped while the CPU itself was still AOK */
+typedef enum {
+    STOP_NONE = 0, STOP_BUDGET, STOP_TIMEOUT, STOP_LOOP, STOP_BREAK, STOP_WATCH,
+    STOP_INPUT
+} machine_stop_t;
+
+/* a watched range of guest memory */
+typedef struct machine_watch {
+
+    address_t start;            // first watched address
+    address_t end;              // one past the last watched address
+    bool read;                  // stop on loads
+    bool write;                 // stop on stores
+
+} machine_watch_t;
+
+/* the access that stopped execution with STOP_WATCH */
+typedef struct watch_hit {
+
+    machine_watch_t watch;      // watchpoint that matched
+    mem_access_t type;          // ACCESS_READ or ACCESS_WRITE
+    address_t pc;               // instruction making the access
+    address_t addr;             // first address accessed
+    uint64_t old;               // contents before the access
+    uint64_t val;               // contents after the access
+    size_t size;                // bytes accessed
+
+} watch_hit_t;
+
+typedef struct machine machine_t;
+
+/* called after every fetch and before the instruction executes; a failed
+   fetch is reported too, with m->cpu.stat no longer AOK */
+typedef void (*fetch_hook_t) (machine_t *m, void *arg, y86_inst_t *inst);
+
+/* called after every instruction that executed, once m->count includes it;
+   pc is the address the instruction was fetched from */
+typedef void (*exec_hook_t) (machine_t *m, void *arg, address_t pc,
+        y86_inst_t *inst, bool cnd, y86_reg_t valA, y86_reg_t valE);
+
+/* called at the end of each basic block (after a jump, call or return, or
+   when execution stops) with the block's first address and length */
+typedef void (*block_hook_t) (machine_t *m, void *arg, address_t start,
+        uint64_t insts);
+
+/* called when machine_rewind is about to undo input traps, with the count
+   it goes back to; returns false if the input source cannot read the same
+   values again from there */
+typedef bool (*rewind_hook_t) (machine_t *m, void *arg, uint64_t count);
+
+/* a loaded Y86 program and the state of its execution */
+struct machine {
+
+    y86_t cpu;                  // CPU state
+    byte_t memory[MEMSIZE];     // guest address space
+    uint64_t count;             // instructions executed since the last reset
+    machine_stop_t stop;        // reason a limit ended execution, if any
+
+    uint64_t limit;             // total instruction limit (0 for none)
+    double timeout;             // wall-clock limit in seconds (0 for none)
+    bool started;               // the wall clock is running
+    struct timespec deadline;   // time at which the run is stopped
+    loopdet_t *loop;            // infinite-loop detector (NULL when off)
+    journal_t *journal;         // undo journal (NULL when off)
+    coverage_t *coverage;       // code coverage (NULL when off)
+    uint64_t dirty[DIRTY_WORDS];    // regions stored to since the last clear
+
+    elf_hdr_t hdr;              // header of the loaded image
+    elf_phdr_t *phdrs;          // program headers of the loaded image
+    byte_t image[MEMSIZE];      // memory as loaded, restored by machine_reset
+    symtab_t symbols;           // symbols of the loaded image (may be empty)
+
+    fetch_hook_t fetch_hook;    // instrumentation (NULL when unused)
+    exec_hook_t exec_hook;
+    block_hook_t block_hook;
+    void *hook_arg;
+    store_hook_t store_fn;      // observer of guest stores (NULL when unused)
+    void *store_arg;
+    rewind_hook_t rewind_fn;    // rewinds the input source (NULL when unused)
+    void *rewind_arg;
+
+    address_t block_start;      // first address of the current basic block
+    uint64_t block_insts;       // instructions in the current basic block
+
+    uint64_t breaks[MEMSIZE / 64];  // one bit per breakpoint address
+    int nbreaks;
+
+    machine_watch_t *watches;   // watched ranges
+    int nwatches;
+    uint64_t watched[WATCH_WORDS];  // pages holding a watched range
+    watch_hit_t hit;            // access behind the last STOP_WATCH
+    bool parked;                // machine_stop set the CPU to HLT to end the run
+
+};
+
+/**
+ * @brief Allocate an empty machine with zeroed memory
+ *
+ * @returns The new machine, or NULL if allocation failed
+ */
+machine_t *machine_create (void);
+
+/**
+ * @brief Release a machine and everything it owns
+ *
+ * @param m Machine to destroy (may be NULL)
+ */
+void machine_destroy (machine_t *m);
+
+/**
+ * @brief Load a Mini-ELF image from an open file and reset the machine to
+ * its entry point
+ *
+ * If the image is not valid, the machine keeps its previous image and state.
+ *
+ * @param m Machine to load into
+ * @param file Open Mini-ELF file
+ * @returns True if the header and every segment were valid
+ */
+bool machine_load (machine_t *m, FILE *file);
+
+/**
+ * @brief Load a Mini-ELF image from a file on disk
+ *
+ * @param m Machine to load into
+ * @param filename Path of the Mini-ELF file
+ * @returns True if the file could be opened and loaded
+ */
+bool machine_load_file (machine_t *m, const char *filename);
+
+/**
+ * @brief Load a Mini-ELF image held in memory
+ *
+ * @param m Machine to load into
+ * @param buf Bytes of the Mini-ELF file
+ * @param len Length of the buffer in bytes
+ * @returns True if the image was loaded
+ */
+bool machine_load_buffer (machine_t *m, const byte_t *buf, size_t len);
+
+/**
+ * @brief Restore the loaded image and restart at its entry point
+ *
+ * Registers, flags, the instruction count and any stop reason are cleared;
+ * hooks and limits are kept. Only the regions marked dirty are copied back,
+ * so code that writes m->memory directly must call machine_mark_dirty.
+ *
+ * @param m Machine to reset
+ */
+void machine_reset (machine_t *m);
+
+/**
+ * @brief Install instrumentation callbacks; any may be NULL
+ *
+ * With every hook NULL, machine_run uses a loop with no hook checks at all.
+ *
+ * @param m Machine to instrument
+ * @param fetch Callback after each fetch
+ * @param exec Callback after each executed instruction
+ * @param block Callback at the end of each basic block
+ * @param arg Argument passed through to every callback
+ */
+void machine_set_hooks (machine_t *m, fetch_hook_t fetch, exec_hook_t exec,
+        block_hook_t block, void *arg);
+
+/**
+ * @brief Report every guest store to a callback, in both run loops
+ *
+ * The callback sees each store after it is made, with the bytes' old and new
+ * values, the same way the undo journal and loop detector do.
+ *
+ * @param m Machine to instrument
+ * @param hook Callback after each store, or NULL to remove it
+ * @param arg Argument passed through to the callback
+ */
+void machine_set_store_hook (machine_t *m, store_hook_t hook, void *arg);
+
+/**
+ * @brief Let machine_rewind go back over input traps
+ *
+ * Without a hook, or when it returns false, a rewind that would undo a
+ * CHARIN or DECIN trap is refused: the values it read cannot be put back.
+ *
+ * @param m Machine to change
+ * @param hook Callback that moves the input source back, or NULL to remove it
+ * @param arg Argument passed through to the callback
+ */
+void machine_set_rewind_hook (machine_t *m, rewind_hook_t hook, void *arg);
+
+/**
+ * @brief Set limits that stop execution with STOP_BUDGET or STOP_TIMEOUT
+ *
+ * The instruction limit counts from the last reset; the wall clock starts at
+ * the first machine_run or machine_step after a reset. The clock is only
+ * read every WATCHDOG_BATCH instructions.
+ *
+ * @param m Machine to limit
+ * @param insts Maximum total instructions (0 for no limit)
+ * @param seconds Maximum wall-clock run time (0 for no limit)
+ */
+void machine_set_limits (machine_t *m, uint64_t insts, double seconds);
+
+/**
+ * @brief Find the next run of dirty memory regions
+ *
+ * Regions become dirty when the guest stores to them and stay dirty until
+ * machine_clear_dirty or machine_reset. Enumerate them with
+ *
+ *     address_t start = 0, end;
+ *     while (machine_next_dirty(m, &start, &end)) { ...; start = end; }
+ *
+ * @param m Machine to inspect
+ * @param start In: address to search from; out: first dirty address found
+ * @param end Out: address just past the run of dirty regions
+ * @returns False if nothing at or after the search address is dirty
+ */
+bool machine_next_dirty (machine_t *m, address_t *start, address_t *end);
+
+/**
+ * @brief Forget which regions are dirty
+ *
+ * @param m Machine to clear
+ */
+void machine_clear_dirty (machine_t *m);
+
+/**
+ * @brief Mark a range as dirty after writing m->memory from outside the guest
+ *
+ * @param m Machine that was written
+ * @param addr First address written
+ * @param size Number of bytes written
+ */
+void machine_mark_dirty (machine_t *m, address_t addr, size_t size);
+
+/**
+ * @brief Turn infinite-loop detection on or off
+ *
+ * While on, the machine state is compared at every taken backward jump and
+ * execution stops with STOP_LOOP once a state repeats exactly. Input traps
+ * (CHARIN, DECIN) clear the history, since the input may differ next time.
+ *
+ * @param m Machine to configure
+ * @param enable True to detect loops
+ * @returns False if the detector could not be allocated
+ */
+bool machine_detect_loops (machine_t *m, bool enable);
+
+/**
+ * @brief Turn code coverage on or off
+ *
+ * While on, m->coverage records every instruction start executed and the
+ * directions taken by conditional jumps, in every run loop. Coverage is kept
+ * across machine_reset, so repeated runs accumulate.
+ *
+ * @param m Machine to configure
+ * @param enable True to record coverage (starting from none)
+ * @returns False if the bitmaps could not be allocated
+ */
+bool machine_cover (machine_t *m, bool enable);
+
+/**
+ * @brief Start recording an undo journal so the machine can run backward
+ *
+ * @param m Machine to record
+ * @param spec Journal specification window[:snapshot-interval], or NULL for
+ *        the defaults
+ * @returns False if the specification was invalid or allocation failed
+ */
+bool machine_record (machine_t *m, const char *spec);
+
+/**
+ * @brief Move the machine back to an earlier instruction count
+ *
+ * Requires machine_record. Running forward afterwards executes the program
+ * again from that point. Going back over an input trap also needs the hook
+ * set with machine_set_rewind_hook, so the trap reads the same value again.
+ *
+ * @param m Machine to rewind
+ * @param target Instruction count to return to
+ * @returns False if the target is in the future or outside the journal
+ *          window, or if the input source cannot go back with it
+ */
+bool machine_rewind (machine_t *m, uint64_t target);
+
+/**
+ * @brief Undo the most recent instruction
+ *
+ * @param m Machine to step back
+ * @returns False if there is nothing left in the journal to undo
+ */
+bool machine_step_back (machine_t *m);
+
+/**
+ * @brief Set or clear a breakpoint
+ *
+ * machine_run stops with STOP_BREAK before executing the instruction at a
+ * breakpoint, except the one it starts on. Guest memory is left alone, so a
+ * breakpoint on an operand or data byte never changes what the program
+ * does. While any breakpoint is set, machine_run tests the bitmap bit of each
+ * PC before the fetch; with none set, it runs the loop without the test.
+ *
+ * @param m Machine to change
+ * @param addr Address of the instruction
+ * @param on True to set the breakpoint, false to clear it
+ * @returns False if the address is outside guest memory
+ */
+bool machine_set_break (machine_t *m, address_t addr, bool on);
+
+/**
+ * @brief Check whether a breakpoint is set at an address
+ *
+ * @param m Machine to inspect
+ * @param addr Address to check
+ * @returns True if a breakpoint is set there
+ */
+bool machine_is_break (machine_t *m, address_t addr);
+
+/**
+ * @brief Watch a range of guest memory for loads, stores or both
+ *
+ * Execution stops with STOP_WATCH after an instruction whose access overlaps
+ * the range, and m->hit describes the access. Only accesses to pages with a
+ * watchpoint are compared against the ranges. Clear m->stop to carry on.
+ *
+ * @param m Machine to change
+ * @param addr First address to watch
+ * @param len Number of bytes to watch
+ * @param read Stop on loads
+ * @param write Stop on stores
+ * @returns False if the range is empty or outside guest memory, or
+ *          allocation failed
+ */
+bool machine_watch (machine_t *m, address_t addr, size_t len, bool read,
+        bool write);
+
+/**
+ * @brief Remove a watchpoint added with the same arguments
+ *
+ * @param m Machine to change
+ * @param addr First watched address
+ * @param len Number of bytes watched
+ * @param read Watchpoint stops on loads
+ * @param write Watchpoint stops on stores
+ * @returns False if there was no such watchpoint
+ */
+bool machine_unwatch (machine_t *m, address_t addr, size_t len, bool read,
+        bool write);
+
+/**
+ * @brief Fetch and execute a single instruction
+ *
+ * @param m Machine to step
+ * @returns CPU status after the instruction (unchanged if a limit stopped it)
+ */
+y86_stat_t machine_step (machine_t *m);
+
+/**
+ * @brief Execute until the CPU stops, the budget is used up or a limit from
+ * machine_set_limits is reached (see m->stop)
+ *
+ * @param m Machine to run
+ * @param budget Maximum instructions to execute in this call (0 for no limit)
+ * @returns CPU status when the run ended (AOK if the budget ran out)
+ */
+y86_stat_t machine_run (machine_t *m, uint64_t budget);
+
+/**
+ * @brief Stop the run after the current instruction, from a callback that
+ * runs during it (such as an input hook)
+ *
+ * The uninstrumented loop only tests the CPU status, so the status reads HLT
+ * until machine_run or machine_step returns, and AOK again after that.
+ *
+ * @param m Machine that is running
+ * @param why Reason left in m->stop
+ */
+void machine_stop (machine_t *m, machine_stop_t why);
+
+/**
+ * @brief Check whether the machine can execute another instruction
+ *
+ * @param m Machine to check
+ * @returns True if the CPU is AOK and no limit has stopped it
+ */
+bool machine_running (machine_t *m);
+
+#endif
@@ -8,9 +8,55 @@
 #include "p2-load.h"
 #include "p3-disas.h"
 #include "p4-interp.h"
+#include "machine.h"
+#include "pipe.h"
+#include "bpred.h"
+#include "cache.h"
+#include "ooo.h"
+#include "critpath.h"
+#include "sample.h"
+#include "checkpoint.h"
+#include "memdiff.h"
+#include "gdbstub.h"
+#include "memtrace.h"
+#include "tracefilter.h"
+#include "deltatrace.h"
+#include "lockstep.h"
+#include "inputlog.h"
 #include <assert.h>
 
+/* exit status when a limit or the loop detector stopped the program */
+#define EXIT_STOPPED 2
+
+/* analysis models fed by the execution hooks */
+typedef struct models {
+
+    exec_opts_t *opts;
+    pipe_t pipe;
+    bpred_t bpred;
+    cache_sim_t cache;
+    ooo_t ooo;
+    critpath_t critpath;
+    sampler_t sampler;
+    memtrace_t memtrace;
+    tracefilter_t filter;
+    deltatrace_t delta;
+
+} models_t;
+
 void terminate_bad();
+void trace_fetch(machine_t *m, void *arg, y86_inst_t *inst);
+void models_exec(machine_t *m, void *arg, address_t pc, y86_inst_t *inst,
+        bool cnd, y86_reg_t valA, y86_reg_t valE);
+void models_access(void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size);
+void dump_models(models_t *models, uint64_t count, bool trace);
+void save_checkpoint(machine_t *m, const char *filename);
+bool add_watch(machine_t *m, const char *spec);
+void dump_watch_hit(machine_t *m);
+bool merge_coverage(machine_t *m, const char *files);
+bool report_coverage(machine_t *m, const char *files);
+bool rewind_after_run(machine_t *m, void *arg, uint64_t count);
 
 int main (int argc, char **argv)
 {
@@ -22,19 +68,24 @@ int main (int argc, char **argv)
     bool disas_data = false;
     bool exec_normal = false;
     bool exec_trace = false;
+    exec_opts_t opts;
 
     char *filename;
-    FILE *file;
+    int status = EXIT_SUCCESS;
 
-    elf_hdr_t hdr;
+    models_t models;
+    memset(&models, 0x00, sizeof(models));
+    models.opts = &opts;
+    pipe_init(&models.pipe);
 
     // parse command line
     if (parse_command_line_p4(argc, argv, &header, &segments, &membrief,
                               &memfull, &disas_code, &disas_data,
-                              &exec_normal, &exec_trace, &filename)) {
+                              &exec_normal, &exec_trace, &opts, &filename)) {
         // close if -h option selected
         if (!header && !segments && !membrief && !memfull && !disas_code
-              && !disas_data && !exec_normal && !exec_trace) {
+              && !disas_data && !exec_normal && !exec_trace
+              && opts.coverage == NULL) {
             return(EXIT_SUCCESS);
         }
     } else {
@@ -42,33 +93,51 @@ int main (int argc, char **argv)
         return(EXIT_FAILURE);
     }
 
-    // open file and check for validity
-    file = fopen(filename, "r");
-    if (file == NULL) {
-        terminate_bad();
+    // with -A, standard out reaches its pipe in large blocks; the buffer can
+    // only be changed before anything is printed
+    if (opts.async) {
+        setvbuf(stdout, NULL, _IOFBF, ASYNC_STDIO_BUFFER);
     }
 
-    // load the header and check if it is valid
-    if (!read_header(file, &hdr)) {
-        terminate_bad();
+    // set up the branch predictor before loading anything
+    if (opts.bpred != NULL && !bpred_init(&models.bpred, opts.bpred)) {
+        printf("Invalid branch predictor: %s\n", opts.bpred);
+        return EXIT_FAILURE;
+    }
+    if (opts.cache != NULL && !cache_init(&models.cache, opts.cache)) {
+        printf("Invalid cache specification: %s\n", opts.cache);
+        return EXIT_FAILURE;
+    }
+    if (opts.ooo != NULL && !ooo_init(&models.ooo, opts.ooo)) {
+        printf("Invalid out-of-order model specification: %s\n", opts.ooo);
+        return EXIT_FAILURE;
+    }
+    if (opts.critpath && !critpath_init(&models.critpath)) {
+        printf("Failed to allocate critical-path analyzer\n");
+        return EXIT_FAILURE;
+    }
+    if (opts.sample != NULL && !sample_init(&models.sampler, opts.sample)) {
+        printf("Invalid sampling specification: %s\n", opts.sample);
+        return EXIT_FAILURE;
+    }
+    if (opts.memtrace != NULL
+          && !memtrace_open(&models.memtrace, opts.memtrace, opts.async)) {
+        printf("Failed to create memory trace: %s\n", opts.memtrace);
+        return EXIT_FAILURE;
     }
 
-    // allocate memory on the heap
-    byte_t *memory = (byte_t*)calloc(MEMSIZE, sizeof(byte_t));
-    assert(memory != NULL);
-
-    // read program headers from file into an array of phdrs,
-    // load those segments into virtual memory, and check for validity
-    elf_phdr_t phdrs[hdr.e_num_phdr];
-    int offset;
-    for (int i = 0; i < hdr.e_num_phdr; i++) {
-        offset = hdr.e_phdr_start + (i * sizeof(elf_phdr_t));
-        if (!read_phdr(file, offset, &phdrs[i]) || !load_segment(file, memory, phdrs[i])) {
-            free(memory);
-            terminate_bad();
-        }
+    // load the header and segments into a fresh machine, checking validity
+    machine_t *m = machine_create();
+    assert(m != NULL);
+    if (!machine_load_file(m, filename)) {
+        machine_destroy(m);
+        terminate_bad();
     }
 
+    elf_hdr_t hdr = m->hdr;
+    elf_phdr_t *phdrs = m->phdrs;
+    byte_t *memory = m->memory;
+
     // print the relevant info
     if (header) {
         dump_header(hdr);
@@ -111,116 +180,301 @@ int main (int argc, char **argv)
             }
         }
     }
-    if (exec_normal) {
-        y86_t cpu;
-        memset(&cpu, 0x00, sizeof(cpu));
-        cpu.stat = AOK;
-        cpu.pc = hdr.e_entry;
-        uint32_t count = 0;
-
-        printf("Beginning execution at 0x%04x\n", hdr.e_entry);
 
-        // loop until cpu status is not ok
-        while (cpu.stat == AOK) {
+    // attach the cache simulator and trace exporter to guest memory accesses
+    // during execution, calling straight into whichever is alone
+    if (opts.cache != NULL && opts.memtrace != NULL) {
+        set_mem_hook(models_access, &models);
+    } else if (opts.cache != NULL) {
+        set_mem_hook(cache_access, &models.cache);
+    } else if (opts.memtrace != NULL) {
+        set_mem_hook(memtrace_access, &models.memtrace);
+    }
 
-            bool cnd = false;
-            y86_reg_t valA = 0;
-            y86_reg_t valE = 0;
-            y86_inst_t inst;
+    // coverage saved by earlier runs, which this run (if any) adds to
+    if (opts.coverage != NULL) {
+        if (!machine_cover(m, true)) {
+            printf("Failed to allocate coverage bitmaps\n");
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        if (!merge_coverage(m, opts.coverage)) {
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+    }
 
-            // fetch instruction
-            inst = fetch(&cpu, memory);
+    if (exec_normal || exec_trace) {
+        bool analysis = opts.pipe || opts.bpred != NULL || opts.ooo != NULL
+            || opts.critpath || opts.sample != NULL;
+
+        // only instrument the run when something consumes the hooks
+        machine_set_hooks(m, exec_trace ? trace_fetch : NULL,
+                analysis ? models_exec : NULL, NULL, &models);
+        machine_set_limits(m, opts.limit, opts.timeout);
+        if (opts.loops && !machine_detect_loops(m, true)) {
+            printf("Failed to allocate loop detector\n");
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        if ((opts.journal != NULL || opts.rewind)
+              && !machine_record(m, opts.journal)) {
+            printf("Invalid journal specification: %s\n",
+                    opts.journal != NULL ? opts.journal : "default");
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < opts.nwatch; i++) {
+            if (!add_watch(m, opts.watch[i])) {
+                printf("Invalid watchpoint: %s\n", opts.watch[i]);
+                machine_destroy(m);
+                return EXIT_FAILURE;
+            }
+        }
+        if (opts.filter != NULL
+              && !tracefilter_init(&models.filter, opts.filter, &m->symbols)) {
+            printf("Invalid trace filter: %s\n", opts.filter);
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        if (opts.delta) {
+            if (!deltatrace_open(&models.delta)) {
+                printf("Failed to allocate compact trace\n");
+                machine_destroy(m);
+                return EXIT_FAILURE;
+            }
+            machine_set_store_hook(m, deltatrace_store, &models.delta);
+        }
 
-            // only continue if cpu status is AOK
-            if (cpu.stat == AOK) {
-                // decode and execute instruction
-                valE = decode_execute(&cpu, inst, &cnd, &valA);
+        if (opts.restore != NULL) {
+            if (!checkpoint_restore(m, opts.restore)) {
+                printf("Failed to read checkpoint: %s\n", opts.restore);
+                machine_destroy(m);
+                return EXIT_FAILURE;
+            }
+            printf("Resuming execution at 0x%04lx after %" PRIu64 " instructions\n",
+                    m->cpu.pc, m->count);
+        } else {
+            printf("Beginning execution at 0x%04x\n", m->hdr.e_entry);
+        }
 
-                // write to memory, registers, and update upgram counter
-                memory_wb_pc(&cpu, inst, memory, cnd, valA, valE);
+        // input traps read through the log from wherever the machine starts
+        inputlog_t inputlog;
+        bool logged = opts.input_record != NULL || opts.input_replay != NULL;
+        if (opts.input_record != NULL
+              && !inputlog_record(&inputlog, opts.input_record, m)) {
+            printf("Failed to allocate input log\n");
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        if (opts.input_replay != NULL
+              && !inputlog_replay(&inputlog, opts.input_replay, m)) {
+            printf("Failed to read input log: %s\n", opts.input_replay);
+            machine_destroy(m);
+            return EXIT_FAILURE;
+        }
+        if (logged) {
+            set_input_hook(inputlog_read, &inputlog);
+            machine_set_rewind_hook(m, inputlog_rewind, &inputlog);
+        }
 
-                count++;
+        // the reference engine starts from wherever the machine starts
+        lockstep_t *lockstep = NULL;
+        if (opts.lockstep != NULL) {
+            lockstep = (lockstep_t*)malloc(sizeof(lockstep_t));
+            if (lockstep == NULL || !lockstep_init(lockstep, opts.lockstep, m)) {
+                printf("Invalid lockstep specification: %s\n", opts.lockstep);
+                free(lockstep);
+                machine_destroy(m);
+                return EXIT_FAILURE;
             }
+        }
 
-            // increment pc if status became ADR between decode and pc steps
-            if (cpu.stat == ADR) {
-                cpu.pc += 10;
+        // with -A, everything printed from here on is written by another thread
+        async_out_t out;
+        if (opts.async) {
+            fflush(stdout);
+            if (!async_redirect(&out, STDOUT_FILENO, ASYNC_RING_SIZE)) {
+                printf("Failed to start output thread\n");
+                machine_destroy(m);
+                return EXIT_FAILURE;
             }
+        }
 
-            if (cpu.pc >= MEMSIZE) {
-                cpu.stat = ADR;
-            }
+        // the first sampling checkpoint is the initial state
+        if (opts.sample != NULL) {
+            models.sampler.next = m->count;
+            sample_checkpoint(&models.sampler, &m->cpu, m->memory);
+        }
 
+        uint64_t every = opts.ckpt_every;
+        if (opts.gdb != NULL) {
+            // the debugger decides what runs
+            if (!gdb_serve(m, opts.gdb)) {
+                printf("Failed to open debugger socket: %s\n", opts.gdb);
+                status = EXIT_FAILURE;
+            }
+        } else if (lockstep != NULL) {
+            // the reference engine decides how far each stretch runs
+            if (!lockstep_run(lockstep, m)) {
+                status = EXIT_FAILURE;
+            }
+        } else if (exec_normal && opts.ckpt_file != NULL) {
+            // run up to each checkpoint boundary in turn
+            while (machine_running(m)) {
+                machine_run(m, every - m->count % every);
+                if (machine_running(m)) {
+                    save_checkpoint(m, opts.ckpt_file);
+                }
+            }
+        } else if (exec_normal) {
+            machine_run(m, 0);
+        } else {
+            // dump cpu state before each instruction
+            while (machine_running(m)) {
+                if (opts.filter != NULL && tracefilter_waiting(&models.filter, m)) {
+                    // nothing to print: run untraced up to the next point of
+                    // interest or checkpoint
+                    if (opts.delta) {
+                        deltatrace_flush(&models.delta, m);
+                    }
+                    tracefilter_skip(&models.filter, m, opts.ckpt_file != NULL
+                            ? every - m->count % every : 0);
+                } else {
+                    if (opts.filter == NULL && !opts.delta) {
+                        dump_cpu_state(m->cpu);
+                    }
+                    machine_step(m);
+                }
+                if (opts.ckpt_file != NULL && m->count % every == 0
+                      && machine_running(m)) {
+                    save_checkpoint(m, opts.ckpt_file);
+                }
+            }
         }
 
-        // dump cpu state
-        dump_cpu_state(cpu);
-        printf("Total execution count: %d\n", count);
-    }
-    if (exec_trace) {
-        y86_t cpu;
-        memset(&cpu, 0x00, sizeof(cpu));
-        cpu.stat = AOK;
-        cpu.pc = hdr.e_entry;
-        uint32_t count = 0;
-
-        printf("Beginning execution at 0x%04x\n", hdr.e_entry);
-
-        // loop until cpu status is not ok
-        while (cpu.stat == AOK) {
-
-            bool cnd = false;
-            y86_reg_t valA;
-            y86_reg_t valE;
-            y86_inst_t inst;
-
-            // dump cpu state on each iteration
-            dump_cpu_state(cpu);
-            
-            // fetch instruction
-            inst = fetch(&cpu, memory);
-
-            // only continue if cpu status is AOK
-            if (cpu.stat == AOK) {
-                // print instruction
-                printf("\nExecuting: ");
-                disassemble(inst);
-                printf("\n");
+        if (opts.delta) {
+            deltatrace_close(&models.delta, m);
+            printf("\n");
+        }
 
-                // decode and execute instruction
-                valE = decode_execute(&cpu, inst, &cnd, &valA);
+        // a run cut short by a limit can be resumed from its final state
+        if (opts.ckpt_file != NULL
+              && (m->stop == STOP_BUDGET || m->stop == STOP_TIMEOUT)) {
+            save_checkpoint(m, opts.ckpt_file);
+        }
 
-                // write to memory, registers, and update upgram counter
-                memory_wb_pc(&cpu, inst, memory, cnd, valA, valE);
+        // dump cpu state and the analysis reports
+        dump_cpu_state(m->cpu);
+        printf("Total execution count: %" PRIu64 "\n", m->count);
+        if (m->stop == STOP_BUDGET) {
+            printf("Stopped: instruction limit of %" PRIu64 " reached\n", opts.limit);
+            status = EXIT_STOPPED;
+        } else if (m->stop == STOP_TIMEOUT) {
+            printf("Stopped: time limit of %g seconds reached\n", opts.timeout);
+            status = EXIT_STOPPED;
+        } else if (m->stop == STOP_LOOP) {
+            printf("Stopped: infinite loop detected at 0x%04lx\n", m->cpu.pc);
+            status = EXIT_STOPPED;
+        } else if (m->stop == STOP_WATCH) {
+            dump_watch_hit(m);
+            status = EXIT_STOPPED;
+        }
+        if (logged) {
+            set_input_hook(NULL, NULL);
+            machine_set_rewind_hook(m, NULL, NULL);
+            if (m->stop == STOP_INPUT) {
+                printf("Stopped: input trap does not match the log\n");
+                status = EXIT_FAILURE;
+            }
+            if (!inputlog_close(&inputlog)) {
+                printf("Failed to write input log: %s\n", opts.input_record);
+                status = EXIT_FAILURE;
+            }
+            dump_inputlog(&inputlog);
+        }
+        if (lockstep != NULL) {
+            dump_lockstep(lockstep, m);
+            lockstep_free(lockstep);
+            free(lockstep);
+        }
 
-                count++;
+        // step back through the journal to the requested instruction; the
+        // run is over, so no input trap will read again
+        if (opts.rewind) {
+            machine_set_rewind_hook(m, rewind_after_run, NULL);
+            if (machine_rewind(m, opts.rewind_to)) {
+                printf("Rewound to instruction %" PRIu64 "\n", m->count);
+                dump_cpu_state(m->cpu);
             } else {
-                printf("\nInvalid instruction at 0x%04lx\n", cpu.pc);
+                printf("Cannot rewind to instruction %" PRIu64 ": journal covers %"
+                        PRIu64 " to %" PRIu64 "\n", opts.rewind_to,
+                        journal_oldest(m->journal), m->count);
             }
-
-            // increment pc if status became ADR between decode and pc steps
-            if (cpu.stat == ADR) {
-                cpu.pc += 10;
+        }
+        if (exec_trace) {
+            printf("\n");
+        }
+        dump_models(&models, m->count, exec_trace);
+        if (opts.memtrace != NULL) {
+            set_mem_hook(NULL, NULL);
+            if (memtrace_close(&models.memtrace)) {
+                printf("Memory trace: %" PRIu64 " accesses in %" PRIu64 " bytes\n",
+                        models.memtrace.records, models.memtrace.bytes);
+            } else {
+                printf("Failed to write memory trace: %s\n", opts.memtrace);
+                status = EXIT_FAILURE;
             }
-            
-            if (cpu.pc >= MEMSIZE) {
-                cpu.stat = ADR;
+            if (exec_trace) {
+                printf("\n");
+            }
+        }
+        if (opts.coverage != NULL) {
+            if (!report_coverage(m, opts.coverage)) {
+                status = EXIT_FAILURE;
+            }
+            if (exec_trace) {
+                printf("\n");
             }
-
         }
 
-        // dump cpu state
-        dump_cpu_state(cpu);
-        printf("Total execution count: %d\n\n", count);
+        if (opts.changes) {
+            dump_memory_changes(m);
+        } else if (exec_trace) {
+            dump_memory(m->memory, 0, MEMSIZE);
+        }
 
-        dump_memory(memory, 0, MEMSIZE);
+        if (opts.async) {
+            fflush(stdout);
+            if (!async_restore(&out)) {
+                status = EXIT_FAILURE;
+            }
+        }
+    } else if (opts.coverage != NULL && !report_coverage(m, opts.coverage)) {
+        // without a run, -V only merges and reports the files
+        status = EXIT_FAILURE;
     }
 
-    fclose(file); // close the file
-    free(memory); // free the heap memory
-    memory = NULL; // safe practice
+    machine_destroy(m); // free the machine and its memory
+    m = NULL; // safe practice
+    if (opts.bpred != NULL) {
+        bpred_free(&models.bpred);
+    }
+    if (opts.cache != NULL) {
+        set_mem_hook(NULL, NULL);
+        cache_free(&models.cache);
+    }
+    if (opts.ooo != NULL) {
+        ooo_free(&models.ooo);
+    }
+    if (opts.critpath) {
+        critpath_free(&models.critpath);
+    }
+    if (opts.sample != NULL) {
+        sample_free(&models.sampler);
+    }
 
-    return EXIT_SUCCESS;
+    return status;
 }
 
 /**
@@ -230,4 +484,250 @@ void terminate_bad()
 {
     printf("Failed to read file\n");
     exit(EXIT_FAILURE);
-}
\ No newline at end of file
+}
+
+/**
+ * Trace-mode fetch hook: print each instruction (or, with -F, each one the
+ * filter selects) before it executes, or with -z hand it to the compact trace.
+ */
+void trace_fetch(machine_t *m, void *arg, y86_inst_t *inst)
+{
+    models_t *models = (models_t*)arg;
+    exec_opts_t *opts = models->opts;
+
+    bool traced = opts->filter == NULL
+        || tracefilter_select(&models->filter, m, inst);
+    if (opts->delta) {
+        deltatrace_fetch(&models->delta, m, inst, traced);
+        return;
+    }
+    if (!traced) {
+        return;
+    }
+
+    // a filtered trace prints the state here, once the filter has chosen;
+    // it is the state before the fetch, so a failed fetch still shows AOK
+    if (opts->filter != NULL) {
+        y86_t cpu = m->cpu;
+        cpu.stat = AOK;
+        dump_cpu_state(cpu);
+    }
+
+    if (m->cpu.stat == AOK) {
+        printf("\nExecuting: ");
+        disassemble(*inst);
+        printf("\n");
+    } else {
+        printf("\nInvalid instruction at 0x%04lx\n", m->cpu.pc);
+    }
+}
+
+/**
+ * Execution hook: feed the completed instruction to the timing models and
+ * hand a checkpoint to the sampling workers at each interval.
+ */
+void models_exec(machine_t *m, void *arg, address_t pc, y86_inst_t *inst,
+        bool cnd, y86_reg_t valA, y86_reg_t valE)
+{
+    models_t *models = (models_t*)arg;
+    exec_opts_t *opts = models->opts;
+
+    if (opts->pipe) {
+        pipe_step(&models->pipe, *inst, cnd);
+    }
+    if (opts->bpred != NULL) {
+        bpred_step(&models->bpred, pc, *inst, cnd, m->cpu.pc);
+    }
+    if (opts->ooo != NULL) {
+        ooo_step(&models->ooo, *inst, cnd, valA, valE);
+    }
+    if (opts->critpath) {
+        critpath_step(&models->critpath, pc, *inst, cnd, valA, valE);
+    }
+    if (opts->sample != NULL && m->count == models->sampler.next
+          && m->cpu.stat == AOK && m->cpu.pc < MEMSIZE) {
+        sample_checkpoint(&models->sampler, &m->cpu, m->memory);
+    }
+}
+
+/**
+ * Memory hook used when both the cache simulator and the trace exporter want
+ * every access.
+ */
+void models_access(void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size)
+{
+    models_t *models = (models_t*)arg;
+
+    cache_access(&models->cache, type, pc, addr, size);
+    memtrace_access(&models->memtrace, type, pc, addr, size);
+}
+
+/**
+ * Print the report of every selected model; trace mode separates them with
+ * blank lines.
+ */
+void dump_models(models_t *models, uint64_t count, bool trace)
+{
+    exec_opts_t *opts = models->opts;
+
+    if (opts->pipe) {
+        dump_pipe_stats(&models->pipe);
+        if (trace) {
+            printf("\n");
+        }
+    }
+    if (opts->bpred != NULL) {
+        dump_bpred_stats(&models->bpred);
+        if (trace) {
+            printf("\n");
+        }
+    }
+    if (opts->cache != NULL) {
+        dump_cache_stats(&models->cache);
+        if (trace) {
+            printf("\n");
+        }
+    }
+    if (opts->ooo != NULL) {
+        dump_ooo_stats(&models->ooo);
+        if (trace) {
+            printf("\n");
+        }
+    }
+    if (opts->critpath) {
+        dump_critpath_stats(&models->critpath);
+        if (trace) {
+            printf("\n");
+        }
+    }
+    if (opts->sample != NULL) {
+        sample_finish(&models->sampler);
+        dump_sample_stats(&models->sampler, count);
+        if (trace) {
+            printf("\n");
+        }
+    }
+}
+
+/**
+ * Write a checkpoint, reporting (but surviving) a failure.
+ */
+void save_checkpoint(machine_t *m, const char *filename)
+{
+    if (!checkpoint_save(m, filename)) {
+        printf("Failed to write checkpoint: %s\n", filename);
+    }
+}
+
+/**
+ * Parse a watchpoint of the form addr[:len[:r|w|rw]] and add it to the
+ * machine; by default 8 bytes are watched for stores.
+ */
+bool add_watch(machine_t *m, const char *spec)
+{
+    char *end;
+    uint64_t len = 8;
+    bool read = false;
+    bool write = true;
+
+    address_t addr = strtoull(spec, &end, 0);
+    if (end == spec || *spec == '-') {
+        return false;
+    }
+    if (*end == ':') {
+        char *len_str = end + 1;
+        len = strtoull(len_str, &end, 0);
+        if (end == len_str || *len_str == '-') {
+            return false;
+        }
+    }
+    if (*end == ':') {
+        read = strchr(end + 1, 'r') != NULL;
+        write = strchr(end + 1, 'w') != NULL;
+        if (strspn(end + 1, "rw") != strlen(end + 1)) {
+            return false;
+        }
+    } else if (*end != '\0') {
+        return false;
+    }
+
+    return machine_watch(m, addr, len, read, write);
+}
+
+/**
+ * Report the access that tripped a watchpoint: where it happened, the
+ * instruction responsible and the value before and after.
+ */
+void dump_watch_hit(machine_t *m)
+{
+    watch_hit_t *hit = &m->hit;
+    y86_t cpu = m->cpu;
+
+    cpu.pc = hit->pc;
+    y86_inst_t inst = fetch(&cpu, m->memory);
+
+    printf("Stopped: %s of 0x%04lx by instruction at 0x%04lx: ",
+            hit->type == ACCESS_READ ? "read" : "write", hit->addr, hit->pc);
+    if (cpu.stat == AOK) {
+        disassemble(inst);
+    }
+    printf("\n");
+
+    if (hit->type == ACCESS_READ) {
+        printf("  value 0x%0*" PRIx64 "\n", (int)(2 * hit->size), hit->val);
+    } else {
+        printf("  old 0x%0*" PRIx64 ", new 0x%0*" PRIx64 "\n",
+                (int)(2 * hit->size), hit->old, (int)(2 * hit->size), hit->val);
+    }
+}
+
+/**
+ * OR the coverage files of a -V list into the machine's coverage; the first
+ * file is the output and may not exist yet
+ */
+bool merge_coverage(machine_t *m, const char *files)
+{
+    char copy[1024];
+    if (strlen(files) >= sizeof(copy)) {
+        printf("Coverage file list too long\n");
+        return false;
+    }
+    strcpy(copy, files);
+
+    bool first = true;
+    for (char *name = strtok(copy, ":"); name != NULL; name = strtok(NULL, ":")) {
+        bool missing = access(name, F_OK) != 0;
+        if (!(first && missing) && !coverage_merge_file(m->coverage, name)) {
+            printf("Failed to read coverage file: %s\n", name);
+            return false;
+        }
+        first = false;
+    }
+    return true;
+}
+
+/**
+ * print the coverage report and write the merged coverage to the first file
+ * of a -V list
+ */
+bool report_coverage(machine_t *m, const char *files)
+{
+    char name[1024];
+    snprintf(name, sizeof(name), "%.*s", (int) strcspn(files, ":"), files);
+
+    dump_coverage(m->coverage, &m->hdr, m->phdrs, m->image, &m->symbols);
+    if (!coverage_save(m->coverage, name)) {
+        printf("Failed to write coverage file: %s\n", name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * let -b go back over input traps once the run has finished
+ */
+bool rewind_after_run(machine_t *m, void *arg, uint64_t count)
+{
+    return true;
+}
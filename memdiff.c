@@ -0,0 +1,98 @@
+/*
+ * CS 261: Changed-memory report
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "memdiff.h"
+
+/* bytes shown per row of a changed range */
+#define ROW 16
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool memdiff_next (const byte_t *a, const byte_t *b, size_t len,
+        size_t *start, size_t *end)
+{
+    size_t i = *start;
+
+    // skip equal words, then pinpoint the first differing byte
+    while (i + 8 <= len) {
+        uint64_t wa;
+        uint64_t wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa != wb) {
+            break;
+        }
+        i += 8;
+    }
+    while (i < len && a[i] == b[i]) {
+        i++;
+    }
+    if (i >= len) {
+        return false;
+    }
+    *start = i;
+
+    // extend the range until MEMDIFF_GAP equal bytes in a row
+    size_t last = i;
+    for (size_t j = i + 1; j < len && j - last <= MEMDIFF_GAP; j++) {
+        if (a[j] != b[j]) {
+            last = j;
+        }
+    }
+    *end = last + 1;
+
+    return true;
+}
+
+void memdiff_row (const byte_t *bytes, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        printf(i + 1 < n ? "%02x " : "%02x\n", bytes[i]);
+    }
+}
+
+void dump_memory_changes (machine_t *m)
+{
+    int ranges = 0;
+    size_t bytes = 0;
+
+    // count first so the summary can lead the report
+    for (int pass = 0; pass < 2; pass++) {
+        address_t dirty = 0;
+        address_t dirty_end;
+
+        if (pass == 1) {
+            printf("Changed memory (%d ranges, %zu bytes):\n", ranges, bytes);
+        }
+
+        while (machine_next_dirty(m, &dirty, &dirty_end)) {
+            size_t len = dirty_end - dirty;
+            size_t start = 0;
+            size_t end;
+
+            while (memdiff_next(&m->image[dirty], &m->memory[dirty], len, &start, &end)) {
+                if (pass == 0) {
+                    ranges++;
+                    bytes += end - start;
+                } else {
+                    address_t addr = dirty + start;
+                    printf("  %04lx-%04lx (%zu bytes)\n", addr, dirty + end, end - start);
+                    for (address_t row = addr; row < dirty + end; row += ROW) {
+                        size_t n = dirty + end - row < ROW ? dirty + end - row : ROW;
+                        printf("    %04lx  was ", row);
+                        memdiff_row(&m->image[row], n);
+                        printf("          now ");
+                        memdiff_row(&m->memory[row], n);
+                    }
+                }
+                start = end;
+            }
+            dirty = dirty_end;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef __CS261_MEMDIFF__
+#define __CS261_MEMDIFF__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "y86.h"
+
+/* differences closer together than this many unchanged bytes are reported
+   as one range */
+#define MEMDIFF_GAP 8
+
+/**
+ * @brief Find the next range where two buffers differ
+ *
+ * Unchanged stretches are skipped a word at a time.
+ *
+ * @param a First buffer
+ * @param b Second buffer
+ * @param len Length of both buffers
+ * @param start In: offset to search from; out: first differing offset
+ * @param end Out: offset just past the last differing byte of the range
+ * @returns False if the buffers are equal from the search offset on
+ */
+bool memdiff_next (const byte_t *a, const byte_t *b, size_t len,
+        size_t *start, size_t *end);
+
+/**
+ * @brief Print up to one row of bytes in hex, ending the line
+ *
+ * @param bytes First byte of the row
+ * @param n Bytes in the row
+ */
+void memdiff_row (const byte_t *bytes, size_t n);
+
+/**
+ * @brief Print the ranges of guest memory that differ from the loaded image
+ *
+ * Only regions the guest stored to (see machine_next_dirty) are compared.
+ *
+ * @param m Machine to report on
+ */
+void dump_memory_changes (machine_t *m);
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * CS 261: Guest memory access hook
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "memhook.h"
+
+__thread mem_hook_t mem_hook = NULL;
+__thread void *mem_hook_arg = NULL;
+__thread store_hook_t store_hook = NULL;
+__thread void *store_hook_arg = NULL;
+__thread watch_hook_t watch_hook = NULL;
+__thread void *watch_hook_arg = NULL;
+__thread uint64_t mem_dirty[DIRTY_WORDS];
+__thread uint64_t mem_watched[WATCH_WORDS];
+
+void set_mem_hook (mem_hook_t hook, void *arg)
+{
+    mem_hook = hook;
+    mem_hook_arg = arg;
+}
+
+void set_store_hook (store_hook_t hook, void *arg)
+{
+    store_hook = hook;
+    store_hook_arg = arg;
+}
+
+void set_watch_hook (watch_hook_t hook, void *arg)
+{
+    watch_hook = hook;
+    watch_hook_arg = arg;
+}
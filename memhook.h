@@ -0,0 +1,156 @@
+#ifndef __CS261_MEMHOOK__
+#define __CS261_MEMHOOK__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "y86.h"
+
+/* kinds of guest memory access reported to the access hook */
+typedef enum {
+    ACCESS_FETCH = 0, ACCESS_READ, ACCESS_WRITE
+} mem_access_t;
+
+/* callback invoked for every guest memory access while installed; pc is the
+   address of the instruction making the access */
+typedef void (*mem_hook_t) (void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size);
+
+/* dirty tracking granularity: memory is split into 64-byte regions with one
+   bit each; DIRTY_REGIONS must be a power of two */
+#define DIRTY_SHIFT 6
+#define DIRTY_REGION (1 << DIRTY_SHIFT)
+#define DIRTY_REGIONS (MEMSIZE >> DIRTY_SHIFT)
+#define DIRTY_WORDS ((DIRTY_REGIONS + 63) / 64)
+
+/* callback invoked after every guest store while installed, with the
+   little-endian value the bytes held before and after the store */
+typedef void (*store_hook_t) (void *arg, address_t addr, uint64_t old,
+        uint64_t val, size_t size);
+
+/* watchpoint filter granularity: one bit per 256-byte page; WATCH_PAGES
+   must be a power of two */
+#define WATCH_SHIFT 8
+#define WATCH_PAGES (MEMSIZE >> WATCH_SHIFT)
+#define WATCH_WORDS ((WATCH_PAGES + 63) / 64)
+
+/* callback invoked for loads and stores that touch a watched page, with the
+   little-endian value before and after (the same for loads) */
+typedef void (*watch_hook_t) (void *arg, mem_access_t type, address_t pc,
+        address_t addr, uint64_t old, uint64_t val, size_t size);
+
+/* currently installed hooks (NULL when disabled) and their arguments; each
+   thread has its own, so worker threads never see the main thread's hooks */
+extern __thread mem_hook_t mem_hook;
+extern __thread void *mem_hook_arg;
+extern __thread store_hook_t store_hook;
+extern __thread void *store_hook_arg;
+extern __thread watch_hook_t watch_hook;
+extern __thread void *watch_hook_arg;
+
+/* regions written since the bitmap was last cleared, maintained by every
+   store on this thread */
+extern __thread uint64_t mem_dirty[DIRTY_WORDS];
+
+/* pages holding at least one watchpoint, or within 7 bytes before one, so
+   an access of up to 8 bytes need only test the page it starts in */
+extern __thread uint64_t mem_watched[WATCH_WORDS];
+
+/**
+ * @brief Install or remove the guest memory access hook for this thread
+ *
+ * @param hook Callback to invoke on each access, or NULL to disable
+ * @param arg Argument passed through to every callback
+ */
+void set_mem_hook (mem_hook_t hook, void *arg);
+
+/**
+ * @brief Install or remove the guest store hook for this thread
+ *
+ * @param hook Callback to invoke after each store, or NULL to disable
+ * @param arg Argument passed through to every callback
+ */
+void set_store_hook (store_hook_t hook, void *arg);
+
+/**
+ * @brief Install or remove the watchpoint hook for this thread
+ *
+ * @param hook Callback to invoke on accesses to watched pages, or NULL
+ * @param arg Argument passed through to every callback
+ */
+void set_watch_hook (watch_hook_t hook, void *arg);
+
+/**
+ * @brief Report a guest memory access to the installed hook, if any
+ *
+ * @param type Kind of access
+ * @param pc Address of the instruction making the access
+ * @param addr First guest address accessed
+ * @param size Number of bytes accessed
+ */
+static inline void mem_access (mem_access_t type, address_t pc,
+        address_t addr, size_t size)
+{
+    if (mem_hook != NULL) {
+        mem_hook(mem_hook_arg, type, pc, addr, size);
+    }
+}
+
+/**
+ * @brief Mark the regions covered by a store as dirty
+ *
+ * @param addr First guest address written
+ * @param size Number of bytes written
+ */
+static inline void mark_dirty (address_t addr, size_t size)
+{
+    address_t first = (addr >> DIRTY_SHIFT) & (DIRTY_REGIONS - 1);
+    address_t last = ((addr + size - 1) >> DIRTY_SHIFT) & (DIRTY_REGIONS - 1);
+
+    mem_dirty[first / 64] |= 1ULL << (first % 64);
+    mem_dirty[last / 64] |= 1ULL << (last % 64);
+}
+
+/**
+ * @brief Record a completed guest store in the dirty bitmap and report it to
+ * the installed hook, if any
+ *
+ * @param addr First guest address written
+ * @param old Previous contents of the written bytes
+ * @param val New contents of the written bytes
+ * @param size Number of bytes written
+ */
+static inline void mem_store (address_t addr, uint64_t old, uint64_t val,
+        size_t size)
+{
+    mark_dirty(addr, size);
+    if (store_hook != NULL) {
+        store_hook(store_hook_arg, addr, old, val, size);
+    }
+}
+
+/**
+ * @brief Report a load or store to the watchpoint hook if it touches a
+ * watched page; other accesses cost one bit test
+ *
+ * @param type ACCESS_READ or ACCESS_WRITE
+ * @param pc Address of the instruction making the access
+ * @param addr First guest address accessed
+ * @param old Contents of the bytes before the access
+ * @param val Contents of the bytes after the access
+ * @param size Number of bytes accessed
+ */
+static inline void mem_watch (mem_access_t type, address_t pc, address_t addr,
+        uint64_t old, uint64_t val, size_t size)
+{
+    address_t page = (addr >> WATCH_SHIFT) & (WATCH_PAGES - 1);
+
+    if ((mem_watched[page / 64] >> (page % 64)) & 1) {
+        if (watch_hook != NULL) {
+            watch_hook(watch_hook_arg, type, pc, addr, old, val, size);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * CS 261: Memory-access trace exporter and reader
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "memtrace.h"
+
+/* tag byte fields */
+#define TAG_TYPE 0x03
+#define TAG_SIZE_SHIFT 2
+#define TAG_SIZE 0x3c
+#define TAG_PC 0x40
+
+void trace_flush(memtrace_t *t);
+bool trace_refill(memtrace_t *t);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool memtrace_open (memtrace_t *t, const char *filename, bool async)
+{
+    memset(t, 0x00, sizeof(memtrace_t));
+
+    t->buf = (byte_t*)malloc(MEMTRACE_BUFFER);
+    t->file = fopen(filename, "wb");
+    if (async && t->file != NULL) {
+        t->async = (async_out_t*)malloc(sizeof(async_out_t));
+        if (t->async != NULL
+              && !async_open(t->async, fileno(t->file), ASYNC_RING_SIZE)) {
+            free(t->async);
+            t->async = NULL;
+        }
+    }
+    if (t->buf == NULL || t->file == NULL || (async && t->async == NULL)) {
+        if (t->file != NULL) {
+            fclose(t->file);
+        }
+        free(t->buf);
+        return false;
+    }
+
+    memcpy(t->buf, MEMTRACE_MAGIC, 4);
+    t->buf[4] = MEMTRACE_VERSION & 0xff;
+    t->buf[5] = MEMTRACE_VERSION >> 8;
+    t->buf[6] = 0;
+    t->buf[7] = 0;
+    t->len = MEMTRACE_HEADER_SIZE;
+    t->ok = true;
+
+    return true;
+}
+
+void memtrace_access (void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size)
+{
+    memtrace_t *t = (memtrace_t*)arg;
+
+    if (t->len > MEMTRACE_BUFFER - MEMTRACE_MAX_RECORD) {
+        trace_flush(t);
+    }
+
+    byte_t *start = t->buf + t->len;
+    byte_t *out = start + 1;
+    byte_t tag = type | (size << TAG_SIZE_SHIFT);
+
+    if (type == ACCESS_FETCH) {
+        out = varint_put(out, addr - t->next_fetch);
+        t->last_fetch = addr;
+        t->next_fetch = addr + size;
+    } else {
+        out = varint_put(out, addr - t->last_data);
+        if (pc != t->last_fetch) {
+            tag |= TAG_PC;
+            out = varint_put(out, pc - t->last_fetch);
+        }
+        t->last_data = addr;
+    }
+    *start = tag;
+
+    t->len += out - start;
+    t->records++;
+}
+
+bool memtrace_close (memtrace_t *t)
+{
+    trace_flush(t);
+    if (t->async != NULL) {
+        t->ok = async_close(t->async) && t->ok;
+        free(t->async);
+        t->async = NULL;
+    }
+    t->ok = (fclose(t->file) == 0) && t->ok;
+    free(t->buf);
+    t->file = NULL;
+    t->buf = NULL;
+
+    return t->ok;
+}
+
+bool memtrace_reader_open (memtrace_t *t, const char *filename)
+{
+    memset(t, 0x00, sizeof(memtrace_t));
+
+    t->buf = (byte_t*)malloc(MEMTRACE_BUFFER);
+    t->file = fopen(filename, "rb");
+    if (t->buf == NULL || t->file == NULL) {
+        memtrace_reader_close(t);
+        return false;
+    }
+
+    byte_t header[MEMTRACE_HEADER_SIZE];
+    if (fread(header, 1, MEMTRACE_HEADER_SIZE, t->file) != MEMTRACE_HEADER_SIZE
+          || memcmp(header, MEMTRACE_MAGIC, 4) != 0
+          || (header[4] | (header[5] << 8)) != MEMTRACE_VERSION) {
+        memtrace_reader_close(t);
+        return false;
+    }
+    t->ok = true;
+
+    return true;
+}
+
+int memtrace_read (memtrace_t *t, memtrace_rec_t *rec)
+{
+    // a whole record is in the buffer unless the file ends first
+    if (t->len - t->pos < MEMTRACE_MAX_RECORD) {
+        trace_refill(t);
+    }
+    if (t->pos == t->len) {
+        return t->ok ? 0 : -1;
+    }
+
+    byte_t tag = t->buf[t->pos++];
+    int64_t delta;
+
+    rec->type = tag & TAG_TYPE;
+    rec->size = (tag & TAG_SIZE) >> TAG_SIZE_SHIFT;
+    if (rec->type > ACCESS_WRITE || rec->size == 0 || (tag & 0x80)
+          || (rec->type == ACCESS_FETCH && (tag & TAG_PC))
+          || !varint_get(t->buf, t->len, &t->pos, &delta)) {
+        t->ok = false;
+        return -1;
+    }
+
+    if (rec->type == ACCESS_FETCH) {
+        rec->addr = t->next_fetch + delta;
+        rec->pc = rec->addr;
+        t->last_fetch = rec->addr;
+        t->next_fetch = rec->addr + rec->size;
+    } else {
+        rec->addr = t->last_data + delta;
+        rec->pc = t->last_fetch;
+        if (tag & TAG_PC) {
+            if (!varint_get(t->buf, t->len, &t->pos, &delta)) {
+                t->ok = false;
+                return -1;
+            }
+            rec->pc += delta;
+        }
+        t->last_data = rec->addr;
+    }
+
+    t->records++;
+    return 1;
+}
+
+void memtrace_reader_close (memtrace_t *t)
+{
+    if (t->file != NULL) {
+        fclose(t->file);
+    }
+    free(t->buf);
+    t->file = NULL;
+    t->buf = NULL;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * write out the buffered records, or queue them for the writer thread
+ */
+void trace_flush(memtrace_t *t)
+{
+    if (t->len > 0 && t->async != NULL) {
+        async_write(t->async, t->buf, t->len);
+        t->bytes += t->len;
+        t->len = 0;
+    } else if (t->len > 0) {
+        t->ok = (fwrite(t->buf, 1, t->len, t->file) == t->len) && t->ok;
+        t->bytes += t->len;
+        t->len = 0;
+    }
+}
+
+/**
+ * move the unread bytes to the front of the buffer and fill the rest from
+ * the file
+ */
+bool trace_refill(memtrace_t *t)
+{
+    size_t left = t->len - t->pos;
+    memmove(t->buf, t->buf + t->pos, left);
+
+    size_t got = fread(t->buf + left, 1, MEMTRACE_BUFFER - left, t->file);
+    t->len = left + got;
+    t->pos = 0;
+    t->bytes += got;
+    if (got == 0 && ferror(t->file)) {
+        t->ok = false;
+    }
+    return got > 0;
+}
@@ -0,0 +1,131 @@
+#ifndef __CS261_MEMTRACE__
+#define __CS261_MEMTRACE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asyncout.h"
+#include "memhook.h"
+#include "varint.h"
+#include "y86.h"
+
+/* memory-access trace file format:
+
+     header     magic "Y86T", u16 version, u16 reserved (zero)
+     records    one per access, in execution order, until end of file
+
+   Each record starts with a tag byte:
+
+     bits 0-1   access type (0 fetch, 1 read, 2 write)
+     bits 2-5   access size in bytes (1-10)
+     bit 6      set if a PC delta follows (data accesses only)
+     bit 7      reserved (zero)
+
+   followed by varints (varint.h) of the signed differences:
+
+     fetch      address - (previous fetch address + previous fetch size);
+                the PC is the address
+     read/write address - previous data address, then, if bit 6 is set,
+                PC - address of the previous fetch (otherwise the PC is the
+                address of the previous fetch)
+
+   All predictions start at zero. Straight-line code costs two bytes per
+   fetch and stack traffic two bytes per access. */
+#define MEMTRACE_MAGIC "Y86T"
+#define MEMTRACE_VERSION 1
+#define MEMTRACE_HEADER_SIZE 8
+
+/* largest encoded record: tag plus two 64-bit varints */
+#define MEMTRACE_MAX_RECORD 21
+
+/* bytes buffered before each write to the file */
+#define MEMTRACE_BUFFER (1 << 20)
+
+/* one decoded access */
+typedef struct memtrace_rec {
+
+    mem_access_t type;          // ACCESS_FETCH, ACCESS_READ or ACCESS_WRITE
+    address_t pc;               // instruction making the access
+    address_t addr;             // first address accessed
+    size_t size;                // bytes accessed
+
+} memtrace_rec_t;
+
+/* encoder or decoder state: the predictions the deltas are taken from */
+typedef struct memtrace {
+
+    FILE *file;
+    async_out_t *async;         // writer thread draining to file (or NULL)
+    byte_t *buf;                // pending (writer) or unread (reader) bytes
+    size_t len;
+    size_t pos;                 // next unread byte (reader only)
+    bool ok;                    // no write or format error so far
+
+    address_t next_fetch;       // predicted address of the next fetch
+    address_t last_fetch;       // address of the previous fetch
+    address_t last_data;        // address of the previous data access
+
+    uint64_t records;           // records written or read
+    uint64_t bytes;             // encoded bytes written or read
+
+} memtrace_t;
+
+/**
+ * @brief Create a trace file and write its header
+ *
+ * @param t Trace to initialize
+ * @param filename File to create
+ * @param async Write the file from a background thread
+ * @returns False if the file could not be created
+ */
+bool memtrace_open (memtrace_t *t, const char *filename, bool async);
+
+/**
+ * @brief Append one access to a trace; usable directly as the memory hook
+ *
+ * @param arg Trace being written (memtrace_t*)
+ * @param type Kind of access
+ * @param pc Address of the instruction making the access
+ * @param addr First guest address accessed
+ * @param size Number of bytes accessed
+ */
+void memtrace_access (void *arg, mem_access_t type, address_t pc,
+        address_t addr, size_t size);
+
+/**
+ * @brief Flush and close a trace being written
+ *
+ * @param t Trace to close
+ * @returns False if any write failed
+ */
+bool memtrace_close (memtrace_t *t);
+
+/**
+ * @brief Open a trace file for reading and check its header
+ *
+ * @param t Trace to initialize
+ * @param filename File to read
+ * @returns False if the file is missing or is not a trace
+ */
+bool memtrace_reader_open (memtrace_t *t, const char *filename);
+
+/**
+ * @brief Decode the next access from a trace
+ *
+ * @param t Trace being read
+ * @param rec Out: the access
+ * @returns 1 for a record, 0 at the end of the trace, -1 if it is malformed
+ */
+int memtrace_read (memtrace_t *t, memtrace_rec_t *rec);
+
+/**
+ * @brief Close a trace being read
+ *
+ * @param t Trace to close
+ */
+void memtrace_reader_close (memtrace_t *t);
+
+#endif
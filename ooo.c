@@ -0,0 +1,337 @@
+/*
+ * CS 261: Out-of-order superscalar timing model
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "ooo.h"
+
+/* words tracked for store-to-load dependences */
+#define MEM_WORDS (MEMSIZE / 8 + 2)
+
+bool ooo_parse_setting(ooo_t *ooo, char *setting);
+uint64_t ooo_latency(ooo_t *ooo, y86_inst_t inst, inst_deps_t *deps);
+uint64_t ooo_port(ooo_t *ooo, uint64_t cycle);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool ooo_init (ooo_t *ooo, const char *spec)
+{
+    // check for bad parameters
+    if (ooo == NULL || spec == NULL) {
+        return false;
+    }
+
+    memset(ooo, 0x00, sizeof(ooo_t));
+
+    // default machine: a four-wide core with a modest window
+    ooo->width = 4;
+    ooo->rob_size = 64;
+    ooo->rs_size = 32;
+    ooo->lat_opq = 1;
+    ooo->lat_load = 3;
+    ooo->lat_store = 1;
+
+    // override settings named in the specification
+    if (strcmp(spec, "default") != 0) {
+        char copy[256];
+        if (strlen(spec) >= sizeof(copy)) {
+            return false;
+        }
+        strcpy(copy, spec);
+
+        for (char *setting = strtok(copy, ","); setting != NULL; setting = strtok(NULL, ",")) {
+            if (!ooo_parse_setting(ooo, setting)) {
+                return false;
+            }
+        }
+    }
+
+    if (ooo->width < 1 || ooo->width > OOO_MAX_WIDTH || ooo->rob_size < 1
+          || ooo->rob_size > OOO_MAX_ROB || ooo->rs_size < 1
+          || ooo->rs_size > ooo->rob_size || ooo->lat_opq < 1
+          || ooo->lat_load < 1 || ooo->lat_store < 1) {
+        return false;
+    }
+
+    ooo->commit = (uint64_t*)calloc(ooo->rob_size, sizeof(uint64_t));
+    ooo->rs_free = (uint64_t*)calloc(ooo->rs_size, sizeof(uint64_t));
+    ooo->mem_ready = (uint64_t*)calloc(MEM_WORDS, sizeof(uint64_t));
+    ooo->cal_cycle = (uint64_t*)calloc(OOO_CALENDAR, sizeof(uint64_t));
+    ooo->cal_used = (int*)calloc(OOO_CALENDAR, sizeof(int));
+    if (ooo->commit == NULL || ooo->rs_free == NULL || ooo->mem_ready == NULL
+          || ooo->cal_cycle == NULL || ooo->cal_used == NULL) {
+        ooo_free(ooo);
+        return false;
+    }
+
+    return true;
+}
+
+void ooo_free (ooo_t *ooo)
+{
+    free(ooo->commit);
+    free(ooo->rs_free);
+    free(ooo->mem_ready);
+    free(ooo->cal_cycle);
+    free(ooo->cal_used);
+    memset(ooo, 0x00, sizeof(ooo_t));
+}
+
+void ooo_step (ooo_t *ooo, y86_inst_t inst, bool cnd, y86_reg_t valA, y86_reg_t valE)
+{
+    inst_deps_t deps;
+    uint64_t i = ooo->insts;
+    uint64_t word = 0;
+
+    get_deps(inst, cnd, valA, valE, &deps);
+    if (deps.mem_read || deps.mem_write) {
+        word = (deps.mem_addr % MEMSIZE) / 8;
+    }
+
+    /* dispatch: in order, needs a ROB entry and a reservation station */
+
+    uint64_t dispatch = ooo->last_dispatch;
+    int reason = -1;
+
+    if (ooo->dispatched == ooo->width) {
+        dispatch++;
+    }
+    uint64_t natural = dispatch;
+
+    if (ooo->redirect > dispatch) {
+        dispatch = ooo->redirect;
+        reason = STALL_BRANCH;
+    }
+    if (i >= (uint64_t) ooo->rob_size && ooo->commit[i % ooo->rob_size] + 1 > dispatch) {
+        dispatch = ooo->commit[i % ooo->rob_size] + 1;
+        reason = STALL_ROB;
+    }
+
+    int rs = 0;
+    for (int k = 1; k < ooo->rs_size; k++) {
+        if (ooo->rs_free[k] < ooo->rs_free[rs]) {
+            rs = k;
+        }
+    }
+    if (ooo->rs_free[rs] > dispatch) {
+        dispatch = ooo->rs_free[rs];
+        reason = STALL_RS;
+    }
+
+    if (reason >= 0) {
+        ooo->stalls[reason] += dispatch - natural;
+    }
+    ooo->dispatched = (dispatch == ooo->last_dispatch && i > 0) ? ooo->dispatched + 1 : 1;
+    ooo->last_dispatch = dispatch;
+
+    // sample ROB occupancy; everything older than the ROB has committed
+    if (i >= (uint64_t) ooo->rob_size && ooo->rob_head < i - ooo->rob_size) {
+        ooo->rob_head = i - ooo->rob_size;
+    }
+    while (ooo->rob_head < i && ooo->commit[ooo->rob_head % ooo->rob_size] < dispatch) {
+        ooo->rob_head++;
+    }
+    if (i - ooo->rob_head + 1 > ooo->rob_peak) {
+        ooo->rob_peak = i - ooo->rob_head + 1;
+    }
+
+    /* issue: out of order, once operands are ready and a port is free */
+
+    uint64_t issue = dispatch + 1;
+    uint64_t ready = issue;
+
+    for (int k = 0; k < MAX_SRCS; k++) {
+        if (deps.src[k] != NOREG && ooo->reg_ready[deps.src[k]] > ready) {
+            ready = ooo->reg_ready[deps.src[k]];
+        }
+    }
+    if (deps.reads_flags && ooo->flags_ready > ready) {
+        ready = ooo->flags_ready;
+    }
+    ooo->waits[WAIT_OPERAND] += ready - issue;
+    issue = ready;
+
+    // loads wait for an older store to the same words to forward its data
+    if (deps.mem_read) {
+        if (ooo->mem_ready[word] > ready) {
+            ready = ooo->mem_ready[word];
+        }
+        if (ooo->mem_ready[word + 1] > ready) {
+            ready = ooo->mem_ready[word + 1];
+        }
+    }
+    ooo->waits[WAIT_MEMORY] += ready - issue;
+    issue = ready;
+
+    ready = ooo_port(ooo, issue);
+    ooo->waits[WAIT_PORT] += ready - issue;
+    issue = ready;
+
+    ooo->rs_free[rs] = issue + 1;
+
+    /* execute: results become visible to dependents on completion */
+
+    uint64_t complete = issue + ooo_latency(ooo, inst, &deps);
+
+    for (int k = 0; k < MAX_DSTS; k++) {
+        if (deps.dst[k] != NOREG) {
+            ooo->reg_ready[deps.dst[k]] = complete;
+        }
+    }
+    if (deps.writes_flags) {
+        ooo->flags_ready = complete;
+    }
+    if (deps.mem_write) {
+        ooo->mem_ready[word] = complete;
+        ooo->mem_ready[word + 1] = complete;
+    }
+
+    // conditional jumps are predicted taken; returns and other jumps are
+    // always predicted correctly
+    if (inst.icode == JUMP && inst.ifun.jump != JMP && !cnd) {
+        ooo->redirect = complete + 1;
+    }
+
+    /* commit: in order, up to width per cycle */
+
+    uint64_t commit = complete + 1;
+    if (commit < ooo->last_commit) {
+        commit = ooo->last_commit;
+    }
+    if (commit == ooo->last_commit && ooo->committed == ooo->width) {
+        commit++;
+    }
+    ooo->committed = (commit == ooo->last_commit && i > 0) ? ooo->committed + 1 : 1;
+    ooo->last_commit = commit;
+
+    ooo->commit[i % ooo->rob_size] = commit;
+    ooo->rob_cycles += commit - dispatch;
+    ooo->insts++;
+}
+
+void dump_ooo_stats (ooo_t *ooo)
+{
+    static const char *stall_names[NUM_DISPATCH_STALLS] = {
+        "ROB full", "Reservation stations full", "Branch mispredict"
+    };
+    static const char *wait_names[NUM_ISSUE_WAITS] = {
+        "Register/flag operands", "Store-to-load forwarding", "Issue ports"
+    };
+
+    uint64_t cycles = ooo->insts > 0 ? ooo->last_commit + 1 : 0;
+    int worst_stall = 0;
+    int worst_wait = 0;
+
+    printf("Out-of-order timing model (width %d, %d-entry ROB, %d reservation stations,\n",
+            ooo->width, ooo->rob_size, ooo->rs_size);
+    printf("  latencies: OPq %d, load %d, store %d):\n",
+            ooo->lat_opq, ooo->lat_load, ooo->lat_store);
+    printf("  Cycles: %" PRIu64 "   Instructions: %" PRIu64 "   IPC: %.3f\n",
+            cycles, ooo->insts, cycles > 0 ? (double) ooo->insts / cycles : 0.0);
+    printf("  ROB occupancy: average %.2f, peak %" PRIu64 " of %d\n",
+            cycles > 0 ? (double) ooo->rob_cycles / cycles : 0.0,
+            ooo->rob_peak, ooo->rob_size);
+
+    printf("  Dispatch stalls (cycles):\n");
+    for (int k = 0; k < NUM_DISPATCH_STALLS; k++) {
+        printf("    %-26s %10" PRIu64 " (%5.1f%%)\n", stall_names[k], ooo->stalls[k],
+                cycles > 0 ? 100.0 * ooo->stalls[k] / cycles : 0.0);
+        if (ooo->stalls[k] > ooo->stalls[worst_stall]) {
+            worst_stall = k;
+        }
+    }
+
+    printf("  Issue delays (instruction-cycles):\n");
+    for (int k = 0; k < NUM_ISSUE_WAITS; k++) {
+        printf("    %-26s %10" PRIu64 "\n", wait_names[k], ooo->waits[k]);
+        if (ooo->waits[k] > ooo->waits[worst_wait]) {
+            worst_wait = k;
+        }
+    }
+
+    printf("  Dominant dispatch stall: %s\n",
+            ooo->stalls[worst_stall] > 0 ? stall_names[worst_stall] : "none");
+    printf("  Dominant issue delay: %s\n",
+            ooo->waits[worst_wait] > 0 ? wait_names[worst_wait] : "none");
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * parse one key=value setting of a model specification
+ */
+bool ooo_parse_setting(ooo_t *ooo, char *setting)
+{
+    char key[8];
+    int value;
+    int end = 0;
+
+    // nothing may follow the value
+    if (sscanf(setting, "%7[a-z]=%d%n", key, &value, &end) != 2
+          || setting[end] != '\0') {
+        return false;
+    }
+
+    if (strcmp(key, "width") == 0) {
+        ooo->width = value;
+    } else if (strcmp(key, "rob") == 0) {
+        ooo->rob_size = value;
+    } else if (strcmp(key, "rs") == 0) {
+        ooo->rs_size = value;
+    } else if (strcmp(key, "opq") == 0) {
+        ooo->lat_opq = value;
+    } else if (strcmp(key, "load") == 0) {
+        ooo->lat_load = value;
+    } else if (strcmp(key, "store") == 0) {
+        ooo->lat_store = value;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * get the execution latency of an instruction from its functional unit
+ */
+uint64_t ooo_latency(ooo_t *ooo, y86_inst_t inst, inst_deps_t *deps)
+{
+    if (deps->mem_read) {
+        return ooo->lat_load;
+    }
+    if (deps->mem_write) {
+        return ooo->lat_store;
+    }
+    if (inst.icode == OPQ) {
+        return ooo->lat_opq;
+    }
+
+    return 1;
+}
+
+/**
+ * claim an issue slot in the first cycle at or after the given one that
+ * still has a free port
+ */
+uint64_t ooo_port(ooo_t *ooo, uint64_t cycle)
+{
+    while (true) {
+        int slot = cycle % OOO_CALENDAR;
+
+        // the slot still holds an older cycle, so it is free again
+        if (ooo->cal_cycle[slot] != cycle) {
+            ooo->cal_cycle[slot] = cycle;
+            ooo->cal_used[slot] = 0;
+        }
+        if (ooo->cal_used[slot] < ooo->width) {
+            ooo->cal_used[slot]++;
+            return cycle;
+        }
+        cycle++;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef __CS261_OOO__
+#define __CS261_OOO__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "deps.h"
+#include "y86.h"
+
+/* configuration limits */
+#define OOO_MAX_WIDTH 16
+#define OOO_MAX_ROB 1024
+
+/* number of cycles remembered by the issue port calendar */
+#define OOO_CALENDAR (1 << 14)
+
+/* reasons dispatch of an instruction was held back */
+typedef enum {
+    STALL_ROB = 0, STALL_RS, STALL_BRANCH, NUM_DISPATCH_STALLS
+} ooo_stall_t;
+
+/* reasons issue of a dispatched instruction was held back */
+typedef enum {
+    WAIT_OPERAND = 0, WAIT_MEMORY, WAIT_PORT, NUM_ISSUE_WAITS
+} ooo_wait_t;
+
+/* trace-driven out-of-order superscalar timing model */
+typedef struct ooo {
+
+    // configuration
+    int width;                  // dispatch, issue and commit width
+    int rob_size;               // reorder buffer entries
+    int rs_size;                // reservation station entries
+    int lat_opq;                // OPq latency
+    int lat_load;               // mrmovq/popq/ret latency
+    int lat_store;              // rmmovq/pushq/call latency
+
+    // machine state, in cycles
+    uint64_t *commit;           // commit cycle of the last rob_size instructions
+    uint64_t *rs_free;          // cycle each reservation station frees up
+    uint64_t reg_ready[NUMREGS];
+    uint64_t flags_ready;
+    uint64_t *mem_ready;        // per-word store completion cycle
+    uint64_t redirect;          // front end refetch cycle after a mispredict
+    uint64_t last_dispatch;     // dispatch cycle of the previous instruction
+    int dispatched;             // instructions dispatched in last_dispatch
+    uint64_t last_commit;       // commit cycle of the previous instruction
+    int committed;              // instructions committed in last_commit
+    uint64_t *cal_cycle;        // issue port calendar: cycle held by each slot
+    int *cal_used;              // issue port calendar: issues in that cycle
+
+    // statistics
+    uint64_t insts;
+    uint64_t rob_head;          // oldest instruction still in the ROB
+    uint64_t rob_peak;          // most instructions in the ROB at once
+    uint64_t rob_cycles;        // sum of cycles spent in the ROB
+    uint64_t stalls[NUM_DISPATCH_STALLS];
+    uint64_t waits[NUM_ISSUE_WAITS];
+
+} ooo_t;
+
+/**
+ * @brief Set up an out-of-order model from a command-line specification
+ *
+ * The specification is "default" or a comma-separated list of key=value
+ * settings, where key is width, rob, rs, opq, load or store.
+ *
+ * @param ooo Out-of-order model to initialize
+ * @param spec Model specification string
+ * @returns True if the specification was valid and the model was allocated
+ */
+bool ooo_init (ooo_t *ooo, const char *spec);
+
+/**
+ * @brief Release the tables of an out-of-order model
+ *
+ * @param ooo Out-of-order model to free
+ */
+void ooo_free (ooo_t *ooo);
+
+/**
+ * @brief Schedule one instruction from the functional trace
+ *
+ * @param ooo Out-of-order model to update
+ * @param inst Y86 instruction structure for the executed instruction
+ * @param cnd Condition computed in the execute phase (jumps and moves)
+ * @param valA Value of valA passed to the memory stage
+ * @param valE Value of valE passed to the memory stage
+ */
+void ooo_step (ooo_t *ooo, y86_inst_t inst, bool cnd, y86_reg_t valA, y86_reg_t valE);
+
+/**
+ * @brief Print IPC, ROB occupancy and stall reasons to standard out
+ *
+ * @param ooo Out-of-order model to print
+ */
+void dump_ooo_stats (ooo_t *ooo);
+
+#endif
@@ -49,8 +49,10 @@ bool read_phdr (FILE *file, uint16_t offset, elf_phdr_t *phdr)
         return false;
     }
 
-    // load the phdr
-    fread(phdr, 1, sizeof(elf_phdr_t), file);
+    // load the phdr, failing if the file ends first
+    if (fread(phdr, 1, sizeof(elf_phdr_t), file) != sizeof(elf_phdr_t)) {
+        return false;
+    }
 
     // check if the magic number is wrong
     if (phdr->magic != MAGIC) {
@@ -77,13 +79,16 @@ bool load_segment (FILE *file, byte_t *memory, elf_phdr_t phdr)
         return false;
     }
 
-    // check if address is wrong size
-    if (phdr.p_vaddr < 0 || phdr.p_vaddr > MEMSIZE) {
+    // check if the segment fits in memory
+    if (phdr.p_vaddr < 0 || phdr.p_vaddr > MEMSIZE
+          || phdr.p_filesz > MEMSIZE - phdr.p_vaddr) {
         return false;
     }
 
     // reads the program header into virtual memory and checks if it worked
-    fread(&memory[phdr.p_vaddr], 1, phdr.p_filesz, file);
+    if (fread(&memory[phdr.p_vaddr], 1, phdr.p_filesz, file) != phdr.p_filesz) {
+        return false;
+    }
 
     return true; // everything worked as intended
 }
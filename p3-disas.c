@@ -7,7 +7,7 @@
 #include "p3-disas.h"
 
 void print_spaces();
-void print_reg(y86_reg_t reg);
+void print_reg(FILE *out, y86_reg_t reg);
 size_t inst_size(y86_inst_t ins);
 
 /**********************************************************************
@@ -36,6 +36,22 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
         return ins;
     }
 
+    // operands are read from a padded copy near the end of memory, so the
+    // instruction is validated before it is checked to fit; a missing
+    // register byte passes the register checks, leaving that to report ADR
+    byte_t *code = &memory[cpu->pc];
+    byte_t tail[10];
+    if (cpu->pc > MEMSIZE - 10) {
+        memset(tail, 0x00, sizeof(tail));
+        if (ins.icode == PUSHQ || ins.icode == POPQ) {
+            tail[1] = 0x0f;
+        } else if (ins.icode == IRMOVQ) {
+            tail[1] = 0xf0;
+        }
+        memcpy(tail, code, MEMSIZE - cpu->pc);
+        code = tail;
+    }
+
     // calculates address of next instruction (and checks validity)
     switch (ins.icode) {
         // one-byte instr
@@ -59,8 +75,8 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             break;
         // two-byte instr
         case CMOV:
-            ins.ra = memory[cpu->pc + 1] >> 4;
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.ra = code[1] >> 4;
+            ins.rb = code[1] & 0x0f;
             // 6 is highest valid cmov
             if (ins.ifun.cmov > 6 || ins.ra == NOREG || ins.rb == NOREG) {
                 ins.icode = INVALID;
@@ -75,8 +91,8 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             ins.valP = cpu->pc + 2;
             break;
         case OPQ:
-            ins.ra = memory[cpu->pc + 1] >> 4;
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.ra = code[1] >> 4;
+            ins.rb = code[1] & 0x0f;
             // 3 is highest valid opq
             if (ins.ifun.op > 3) {
                 ins.icode = INVALID;
@@ -87,8 +103,8 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             break;
         case PUSHQ:
         case POPQ:
-            ins.ra = memory[cpu->pc + 1] >> 4;
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.ra = code[1] >> 4;
+            ins.rb = code[1] & 0x0f;
             if (ins.ifun.b != 0 || ins.ra == 0xf || ins.rb != 0xf) {
                 ins.icode = INVALID;
                 cpu->stat = INS;
@@ -101,7 +117,7 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             uint64_t dest1 = 0;
             for (int i = 8; i >= 1; i--) {
                 dest1 = dest1 << 8;
-                dest1 += memory[cpu->pc + i];
+                dest1 += code[i];
             }
             ins.valC.dest = dest1;
             if (ins.ifun.jump > 6) { // 6 is highest valid jump
@@ -115,7 +131,7 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             uint64_t dest2 = 0;
             for (int i = 8; i >= 1; i--) {
                 dest2 = dest2 << 8;
-                dest2 += memory[cpu->pc + i];
+                dest2 += code[i];
             }
             ins.valC.dest = dest2;
             if (ins.ifun.b != 0) {
@@ -132,14 +148,14 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             break;
         // ten-byte instr
         case IRMOVQ:
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.rb = code[1] & 0x0f;
             uint64_t v = 0;
             for (int i = 9; i >= 2; i--) {
                 v = v << 8;
-                v += memory[cpu->pc + i];
+                v += code[i];
             }
             ins.valC.v = v;
-            if (ins.ifun.b != 0 || (memory[cpu->pc + 1] >> 4) != 0xf) {
+            if (ins.ifun.b != 0 || (code[1] >> 4) != 0xf) {
                 ins.icode = INVALID;
                 cpu->stat = INS;
                 return ins;
@@ -147,12 +163,12 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             ins.valP = cpu->pc + 10;
             break;
         case RMMOVQ:
-            ins.ra = memory[cpu->pc + 1] >> 4;
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.ra = code[1] >> 4;
+            ins.rb = code[1] & 0x0f;
             uint64_t d1 = 0;
             for (int i = 9; i >= 2; i--) {
                 d1 = d1 << 8;
-                d1 += memory[cpu->pc + i];
+                d1 += code[i];
             }
             ins.valC.d = d1;
             if (ins.ifun.b != 0) {
@@ -168,12 +184,12 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             ins.valP = cpu->pc + 10;
             break;
         case MRMOVQ:
-            ins.ra = memory[cpu->pc + 1] >> 4;
-            ins.rb = memory[cpu->pc + 1] & 0x0f;
+            ins.ra = code[1] >> 4;
+            ins.rb = code[1] & 0x0f;
             uint64_t d2 = 0;
             for (int i = 9; i >= 2; i--) {
                 d2 = d2 << 8;
-                d2 += memory[cpu->pc + i];
+                d2 += code[i];
             }
             ins.valC.d = d2;
             if (ins.ifun.b != 0) {
@@ -187,6 +203,16 @@ y86_inst_t fetch(y86_t *cpu, byte_t *memory)
             break;
     }
 
+    // the whole instruction must lie in memory
+    if (cpu->pc + inst_size(ins) > MEMSIZE) {
+        ins.icode = INVALID;
+        cpu->stat = ADR;
+        return ins;
+    }
+
+    // report the bytes of the instruction to the access hook
+    mem_access(ACCESS_FETCH, cpu->pc, cpu->pc, ins.valP - cpu->pc);
+
     return ins;
 }
 
@@ -322,99 +348,104 @@ bool parse_command_line_p3(int argc, char **argv,
 }
 
 void disassemble(y86_inst_t inst)
+{
+    fdisassemble(stdout, inst);
+}
+
+void fdisassemble(FILE *out, y86_inst_t inst)
 {
     // switch on icode
     switch (inst.icode) {
         // one-byte instr
-        case HALT:    printf("halt");  break;
-        case NOP:     printf("nop");   break;
-        case RET:     printf("ret");   break;
-        case IOTRAP:  printf("iotrap ");
+        case HALT:    fprintf(out, "halt");  break;
+        case NOP:     fprintf(out, "nop");   break;
+        case RET:     fprintf(out, "ret");   break;
+        case IOTRAP:  fprintf(out, "iotrap ");
             switch (inst.ifun.trap) {
-                case CHAROUT:  printf("0");  break;
-                case CHARIN:   printf("1");  break;
-                case DECOUT:   printf("2");  break;
-                case DECIN:    printf("3");  break;
-                case STROUT:   printf("4");  break;
-                case FLUSH:    printf("5");  break;
+                case CHAROUT:  fprintf(out, "0");  break;
+                case CHARIN:   fprintf(out, "1");  break;
+                case DECOUT:   fprintf(out, "2");  break;
+                case DECIN:    fprintf(out, "3");  break;
+                case STROUT:   fprintf(out, "4");  break;
+                case FLUSH:    fprintf(out, "5");  break;
                 case BADTRAP:  return;
             }   break;
         // two-byte instr
         case CMOV:
             switch (inst.ifun.cmov) {
-                case RRMOVQ:   printf("rrmovq");  break;
-                case CMOVLE:   printf("cmovle");  break;
-                case CMOVL:    printf("cmovl");   break;
-                case CMOVE:    printf("cmove");   break;
-                case CMOVNE:   printf("cmovne");  break;
-                case CMOVGE:   printf("cmovge");  break;
-                case CMOVG:    printf("cmovg");   break;
+                case RRMOVQ:   fprintf(out, "rrmovq");  break;
+                case CMOVLE:   fprintf(out, "cmovle");  break;
+                case CMOVL:    fprintf(out, "cmovl");   break;
+                case CMOVE:    fprintf(out, "cmove");   break;
+                case CMOVNE:   fprintf(out, "cmovne");  break;
+                case CMOVGE:   fprintf(out, "cmovge");  break;
+                case CMOVG:    fprintf(out, "cmovg");   break;
                 case BADCMOV:  return;
             }
-            printf(" ");
-            print_reg(inst.ra);
-            printf(", ");
-            print_reg(inst.rb);
+            fprintf(out, " ");
+            print_reg(out, inst.ra);
+            fprintf(out, ", ");
+            print_reg(out, inst.rb);
             break;
         case OPQ:
             switch (inst.ifun.op) {
-                case ADD:      printf("addq");  break;
-                case SUB:      printf("subq");  break;
-                case AND:      printf("andq");  break;
-                case XOR:      printf("xorq");  break;
+                case ADD:      fprintf(out, "addq");  break;
+                case SUB:      fprintf(out, "subq");  break;
+                case AND:      fprintf(out, "andq");  break;
+                case XOR:      fprintf(out, "xorq");  break;
                 case BADOP:    return;
             }
-            printf(" ");
-            print_reg(inst.ra);
-            printf(", ");
-            print_reg(inst.rb);
+            fprintf(out, " ");
+            print_reg(out, inst.ra);
+            fprintf(out, ", ");
+            print_reg(out, inst.rb);
             break;
-        case PUSHQ:  printf("pushq ");  print_reg(inst.ra);  break;
-        case POPQ:   printf("popq ");   print_reg(inst.ra);  break;
+        case PUSHQ:  fprintf(out, "pushq ");  print_reg(out, inst.ra);  break;
+        case POPQ:   fprintf(out, "popq ");   print_reg(out, inst.ra);  break;
         // nine-byte instr
         case JUMP:
             switch (inst.ifun.jump) {
-                case JMP:      printf("jmp");  break;
-                case JLE:      printf("jle");  break;
-                case JL:       printf("jl");   break;
-                case JE:       printf("je");   break;
-                case JNE:      printf("jne");  break;
-                case JGE:      printf("jge");  break;
-                case JG:       printf("jg");   break;
+                case JMP:      fprintf(out, "jmp");  break;
+                case JLE:      fprintf(out, "jle");  break;
+                case JL:       fprintf(out, "jl");   break;
+                case JE:       fprintf(out, "je");   break;
+                case JNE:      fprintf(out, "jne");  break;
+                case JGE:      fprintf(out, "jge");  break;
+                case JG:       fprintf(out, "jg");   break;
                 case BADJUMP:  return;
             }
-            printf(" %#lx", inst.valC.dest);
+            fprintf(out, " %#lx", inst.valC.dest);
             break;
         case CALL:
-            printf("call %#lx", inst.valC.dest);
+            fprintf(out, "call %#lx", inst.valC.dest);
             break;
         // ten-byte instrr
         case IRMOVQ:
-            printf("irmovq ");
-            printf("%#lx, ", inst.valC.v);
-            print_reg(inst.rb);
+            fprintf(out, "irmovq ");
+            fprintf(out, "%#lx, ", inst.valC.v);
+            print_reg(out, inst.rb);
             break;
         case RMMOVQ:
-            printf("rmmovq ");
-            print_reg(inst.ra);
-            printf(", %#lx", inst.valC.d);
+            fprintf(out, "rmmovq ");
+            print_reg(out, inst.ra);
+            fprintf(out, ", %#lx", inst.valC.d);
             if (inst.rb != 0xf) {
-                printf("(");
-                print_reg(inst.rb);
-                printf(")");
+                fprintf(out, "(");
+                print_reg(out, inst.rb);
+                fprintf(out, ")");
             }
             break;
         case MRMOVQ:
-            printf("mrmovq ");
-            printf("%#lx", inst.valC.d);
+            fprintf(out, "mrmovq ");
+            fprintf(out, "%#lx", inst.valC.d);
             if (inst.rb != 0xf) {
-                printf("(");
-                print_reg(inst.rb);
-                printf("), ");
+                fprintf(out, "(");
+                print_reg(out, inst.rb);
+                fprintf(out, "), ");
             } else {
-                printf(", ");
+                fprintf(out, ", ");
             }
-            print_reg(inst.ra);
+            print_reg(out, inst.ra);
             break;
         case INVALID:
             break;
@@ -588,53 +619,53 @@ void print_spaces(int num_printed)
     }
 }
 
-void print_reg(y86_reg_t reg)
+void print_reg(FILE *out, y86_reg_t reg)
 {
     switch(reg) {
         case RAX:
-            printf("%%rax");
+            fprintf(out, "%%rax");
             break;
         case RCX:
-            printf("%%rcx");
+            fprintf(out, "%%rcx");
             break;
         case RDX:
-            printf("%%rdx");
+            fprintf(out, "%%rdx");
             break;
         case RBX:
-            printf("%%rbx");
+            fprintf(out, "%%rbx");
             break;
         case RSP:
-            printf("%%rsp");
+            fprintf(out, "%%rsp");
             break;
         case RBP:
-            printf("%%rbp");
+            fprintf(out, "%%rbp");
             break;
         case RSI:
-            printf("%%rsi");
+            fprintf(out, "%%rsi");
             break;
         case RDI:
-            printf("%%rdi");
+            fprintf(out, "%%rdi");
             break;
         case R8:
-            printf("%%r8");
+            fprintf(out, "%%r8");
             break;
         case R9:
-            printf("%%r9");
+            fprintf(out, "%%r9");
             break;
         case R10:
-            printf("%%r10");
+            fprintf(out, "%%r10");
             break;
         case R11:
-            printf("%%r11");
+            fprintf(out, "%%r11");
             break;
         case R12:
-            printf("%%r12");
+            fprintf(out, "%%r12");
             break;
         case R13:
-            printf("%%r13");
+            fprintf(out, "%%r13");
             break;
         case R14:
-            printf("%%r14");
+            fprintf(out, "%%r14");
             break;
     }
 }
@@ -9,6 +9,7 @@
 #include <unistd.h>
 
 #include "elf.h"
+#include "memhook.h"
 #include "y86.h"
 
 /**
@@ -53,6 +54,14 @@ bool parse_command_line_p3 (int argc, char **argv,
  */
 void disassemble (y86_inst_t inst);
 
+/**
+ * @brief Print the disassembly of a Y86 instruction to a stream
+ *
+ * @param out Stream to print to
+ * @param inst Y86 instruction structure to be printed
+ */
+void fdisassemble (FILE *out, y86_inst_t inst);
+
 /**
  * @brief Print the disassembly of a Y86 code segment
  *
@@ -6,7 +6,14 @@
 
 #include "p4-interp.h"
 
-char buffer[100]; // buffer array for iotraps
+char buffer[IOBUF_SIZE]; // buffer array for iotraps
+
+__thread input_hook_t input_hook = NULL;
+__thread void *input_hook_arg = NULL;
+__thread FILE *iotrap_out = NULL;
+
+/* a 64-bit word of guest memory, which need not be 8-byte aligned */
+typedef uint64_t __attribute__((__aligned__(1), __may_alias__)) mem_word_t;
 
 y86_reg_t get_reg(y86_t *cpu, y86_regnum_t reg_num);
 bool get_cmov_cnd(y86_t *cpu, y86_cmov_t cmov);
@@ -14,7 +21,7 @@ bool get_jump_cnd(y86_t *cpu, y86_jump_t jump);
 y86_reg_t op(y86_t *cpu, y86_inst_t inst, y86_reg_t valA, y86_reg_t valB);
 void write_back(y86_t *cpu, y86_regnum_t reg, y86_reg_t val);
 void iotrap(y86_t *cpu, y86_inst_t inst, byte_t *memory);
-size_t inst_size(y86_inst_t inst);
+int iotrap_input(y86_iotrap_t trap, int *value);
 
 /**********************************************************************
  *                         REQUIRED FUNCTIONS
@@ -99,7 +106,7 @@ void memory_wb_pc (y86_t *cpu, y86_inst_t inst, byte_t *memory,
     }
 
     y86_reg_t valM;
-    uint64_t *mem_block;
+    mem_word_t *mem_block;
 
     // perform last stages according to the instruction
     switch (inst.icode) {
@@ -123,17 +130,26 @@ void memory_wb_pc (y86_t *cpu, y86_inst_t inst, byte_t *memory,
             cpu->pc = inst.valP;
             break;
         case RMMOVQ:
-            mem_block = (uint64_t*) &memory[valE];
+            if (valE > MEMSIZE - 8) {
+                cpu->stat = ADR;
+                break;
+            }
+            mem_access(ACCESS_WRITE, cpu->pc, valE, 8);
+            mem_block = (mem_word_t*) &memory[valE];
+            mem_watch(ACCESS_WRITE, cpu->pc, valE, *mem_block, valA, 8);
+            mem_store(valE, *mem_block, valA, 8);
             *mem_block = valA;
             cpu->pc = inst.valP;
             break;
         case MRMOVQ:
-            if (valE >= MEMSIZE) {
+            if (valE > MEMSIZE - 8) {
                 cpu->stat = ADR;
                 break;
             }
-            mem_block = (uint64_t*) &memory[valE];
+            mem_access(ACCESS_READ, cpu->pc, valE, 8);
+            mem_block = (mem_word_t*) &memory[valE];
             valM = *mem_block;
+            mem_watch(ACCESS_READ, cpu->pc, valE, valM, valM, 8);
             write_back(cpu, inst.ra, valM);
             cpu->pc = inst.valP;
             break;
@@ -149,30 +165,52 @@ void memory_wb_pc (y86_t *cpu, y86_inst_t inst, byte_t *memory,
             cpu->pc = inst.valP;
             break;
         case CALL:
-            if (valE >= MEMSIZE) {
+            if (valE > MEMSIZE - 8) {
                 cpu->stat = ADR;
                 break;
             }
-            mem_block = (uint64_t*) &memory[valE];
+            mem_access(ACCESS_WRITE, cpu->pc, valE, 8);
+            mem_block = (mem_word_t*) &memory[valE];
+            mem_watch(ACCESS_WRITE, cpu->pc, valE, *mem_block, inst.valP, 8);
+            mem_store(valE, *mem_block, inst.valP, 8);
             *mem_block = inst.valP;
             cpu->reg[RSP] = valE;
             cpu->pc = inst.valC.dest;
             break;
         case RET:
-            mem_block = (uint64_t*) &memory[valA];
+            if (valA > MEMSIZE - 8) {
+                cpu->stat = ADR;
+                break;
+            }
+            mem_access(ACCESS_READ, cpu->pc, valA, 8);
+            mem_block = (mem_word_t*) &memory[valA];
             valM = *mem_block;
+            mem_watch(ACCESS_READ, cpu->pc, valA, valM, valM, 8);
             cpu->reg[RSP] = valE;
             cpu->pc = valM;
             break;
         case PUSHQ:
-            mem_block = (uint64_t*) &memory[valE];
+            if (valE > MEMSIZE - 8) {
+                cpu->stat = ADR;
+                break;
+            }
+            mem_access(ACCESS_WRITE, cpu->pc, valE, 8);
+            mem_block = (mem_word_t*) &memory[valE];
+            mem_watch(ACCESS_WRITE, cpu->pc, valE, *mem_block, valA, 8);
+            mem_store(valE, *mem_block, valA, 8);
             *mem_block = valA;
             cpu->reg[RSP] = valE;
             cpu->pc = inst.valP;
             break;
         case POPQ:
-            mem_block = (uint64_t*) &memory[valA];
+            if (valA > MEMSIZE - 8) {
+                cpu->stat = ADR;
+                break;
+            }
+            mem_access(ACCESS_READ, cpu->pc, valA, 8);
+            mem_block = (mem_word_t*) &memory[valA];
             valM = *mem_block;
+            mem_watch(ACCESS_READ, cpu->pc, valA, valM, valM, 8);
             cpu->reg[RSP] = valE;
             write_back(cpu, inst.ra, valM);
             cpu->pc = inst.valP;
@@ -204,17 +242,68 @@ void usage_p4 (char **argv)
     printf("  -D      Disassemble data contents\n");
     printf("  -e      Execute program\n");
     printf("  -E      Execute program (trace mode)\n");
+    printf("  -P      Report PIPE timing model statistics (with -e or -E)\n");
+    printf("  -B pred Simulate a branch predictor (with -e or -E); pred is\n");
+    printf("          taken[:ras], btfnt[:ras], bimodal[:bits[:ras]] or\n");
+    printf("          gshare[:bits[:ras]]; bits is log2 of the table size and\n");
+    printf("          ras the return stack depth\n");
+    printf("  -C spec Simulate L1I/L1D/L2 caches (with -e or -E); spec is default\n");
+    printf("          or level=size:assoc:line[:lru|fifo|random],...\n");
+    printf("  -O spec Report out-of-order timing model statistics (with -e or -E);\n");
+    printf("          spec is default or key=value,... with keys width, rob, rs,\n");
+    printf("          opq, load and store\n");
+    printf("  -c      Report the dataflow critical path and ideal IPC (with -e or -E)\n");
+    printf("  -S spec Estimate PIPE cycles by sampling (with -e or -E); spec is\n");
+    printf("          interval[:window[:threads]] in instructions\n");
+    printf("  -l n    Stop after n instructions (with -e or -E)\n");
+    printf("  -t sec  Stop after sec seconds of wall-clock time (with -e or -E)\n");
+    printf("  -L      Stop when the machine state repeats (with -e or -E)\n");
+    printf("  -k n:file Write a checkpoint to file every n instructions and when a\n");
+    printf("          limit stops the program (with -e or -E)\n");
+    printf("  -r file Resume from a checkpoint file (with -e or -E)\n");
+    printf("  -x      Show only the memory the run changed instead of all of it\n");
+    printf("          (with -e or -E)\n");
+    printf("  -j spec Record an undo journal (with -e or -E); spec is\n");
+    printf("          window[:interval] in instructions\n");
+    printf("  -b n    After the run, step back to instruction count n (with -e\n");
+    printf("          or -E; implies -j)\n");
+    printf("  -g addr Let GDB drive the run over a TCP port on localhost or a\n");
+    printf("          Unix socket path (with -e or -E)\n");
+    printf("  -w spec Stop when memory is accessed (with -e or -E; repeatable);\n");
+    printf("          spec is addr[:len[:r|w|rw]], default 8 bytes written\n");
+    printf("  -T file Write every fetch, load and store to a binary trace file\n");
+    printf("          (with -e or -E; format in memtrace.h)\n");
+    printf("  -A      Write output and traces from a background thread (with -e\n");
+    printf("          or -E)\n");
+    printf("  -F spec Trace only some instructions (with -E); spec is key=value,...\n");
+    printf("          with keys from, to (address or symbol), window (first:last\n");
+    printf("          instruction count), every (n) and icode (name+name...)\n");
+    printf("  -z      Compact trace: one line per instruction with only the\n");
+    printf("          registers, flags and memory it changed (with -E)\n");
+    printf("  -V file[:file...] Report code coverage, merged with the coverage\n");
+    printf("          already in the files, and write it to the first file (the\n");
+    printf("          run adds its own with -e or -E)\n");
+    printf("  -K spec Check the run against the reference engine in lockstep (with\n");
+    printf("          -e); spec is block, to compare at the end of every basic\n");
+    printf("          block, or a number of instructions between comparisons\n");
+    printf("  -I file Record every value input traps read into a log (with -e\n");
+    printf("          or -E)\n");
+    printf("  -i file Feed input traps from a recorded log instead of standard\n");
+    printf("          input (with -e or -E); stops if the program asks for input\n");
+    printf("          anywhere the log does not\n");
 }
 
 bool parse_command_line_p4 (int argc, char **argv,
         bool *header, bool *segments, bool *membrief, bool *memfull,
         bool *disas_code, bool *disas_data,
-        bool *exec_normal, bool *exec_trace, char **filename)
+        bool *exec_normal, bool *exec_trace, exec_opts_t *opts,
+        char **filename)
 {
     // check for bad parameters
     if (argc < 2 || header == NULL || segments == NULL ||
           membrief == NULL || memfull == NULL || disas_code == NULL ||
-          disas_data == NULL || exec_normal == NULL || exec_trace == NULL) {
+          disas_data == NULL || exec_normal == NULL || exec_trace == NULL ||
+          opts == NULL) {
         usage_p4(argv);
         return false;
     }
@@ -228,6 +317,7 @@ bool parse_command_line_p4 (int argc, char **argv,
     *disas_data = false;
     *exec_normal = false;
     *exec_trace = false;
+    memset(opts, 0x00, sizeof(exec_opts_t));
 
     // boolean flags
     bool h_selected = false;
@@ -241,10 +331,12 @@ bool parse_command_line_p4 (int argc, char **argv,
     bool D_selected = false;
     bool e_selected = false;
     bool E_selected = false;
+    bool P_selected = false;
 
     // parse command-line arguments
+    char *end;
     int opt;
-    while ((opt = getopt(argc, argv, "hHafsmMdDeE")) != -1) {
+    while ((opt = getopt(argc, argv, "hHafsmMdDeEPB:C:O:cS:l:t:Lk:r:xj:b:g:w:T:AF:zV:K:I:i:")) != -1) {
         switch (opt) {
             case 'h': h_selected = true; break;
             case 'H': H_selected = true; break;
@@ -257,6 +349,63 @@ bool parse_command_line_p4 (int argc, char **argv,
             case 'D': D_selected = true; break;
             case 'e': e_selected = true; break;
             case 'E': E_selected = true; break;
+            case 'P': P_selected = true; break;
+            case 'B': opts->bpred = optarg; break;
+            case 'C': opts->cache = optarg; break;
+            case 'O': opts->ooo = optarg; break;
+            case 'c': opts->critpath = true; break;
+            case 'S': opts->sample = optarg; break;
+            case 'l':
+                opts->limit = strtoull(optarg, &end, 0);
+                if (*optarg == '-' || *end != '\0' || opts->limit == 0) {
+                    usage_p4(argv);
+                    return false;
+                }
+                break;
+            case 'L': opts->loops = true; break;
+            case 'r': opts->restore = optarg; break;
+            case 'x': opts->changes = true; break;
+            case 'j': opts->journal = optarg; break;
+            case 'g': opts->gdb = optarg; break;
+            case 'T': opts->memtrace = optarg; break;
+            case 'A': opts->async = true; break;
+            case 'F': opts->filter = optarg; break;
+            case 'z': opts->delta = true; break;
+            case 'V': opts->coverage = optarg; break;
+            case 'K': opts->lockstep = optarg; break;
+            case 'I': opts->input_record = optarg; break;
+            case 'i': opts->input_replay = optarg; break;
+            case 'w':
+                if (opts->nwatch == MAX_WATCHES) {
+                    usage_p4(argv);
+                    return false;
+                }
+                opts->watch[opts->nwatch++] = optarg;
+                break;
+            case 'b':
+                opts->rewind_to = strtoull(optarg, &end, 0);
+                if (*optarg == '-' || *end != '\0') {
+                    usage_p4(argv);
+                    return false;
+                }
+                opts->rewind = true;
+                break;
+            case 'k':
+                opts->ckpt_every = strtoull(optarg, &end, 0);
+                if (*optarg == '-' || *end != ':' || end[1] == '\0'
+                      || opts->ckpt_every == 0) {
+                    usage_p4(argv);
+                    return false;
+                }
+                opts->ckpt_file = end + 1;
+                break;
+            case 't':
+                opts->timeout = strtod(optarg, &end);
+                if (*end != '\0' || !(opts->timeout > 0.0)) {
+                    usage_p4(argv);
+                    return false;
+                }
+                break;
             default: usage_p4(argv); return false;
         }
     }
@@ -305,6 +454,9 @@ bool parse_command_line_p4 (int argc, char **argv,
     if (E_selected) {
         *exec_trace = true;
     }
+    if (P_selected) {
+        opts->pipe = true;
+    }
 
     // both -m and -M cannot be selected at the same time
     if (*membrief && *memfull) {
@@ -320,6 +472,41 @@ bool parse_command_line_p4 (int argc, char **argv,
         usage_p4(argv);
         return false;
     }
+    // analysis options only apply when the program is executed
+    if ((opts->pipe || opts->bpred != NULL || opts->cache != NULL || opts->ooo != NULL
+          || opts->critpath || opts->sample != NULL || opts->limit > 0
+          || opts->timeout > 0.0 || opts->loops || opts->ckpt_file != NULL
+          || opts->restore != NULL || opts->changes || opts->journal != NULL
+          || opts->rewind || opts->gdb != NULL || opts->nwatch > 0
+          || opts->memtrace != NULL || opts->async
+          || opts->input_record != NULL || opts->input_replay != NULL)
+          && !*exec_normal && !*exec_trace) {
+        memset(opts, 0x00, sizeof(exec_opts_t));
+        usage_p4(argv);
+        return false;
+    }
+    // filtering and the compact format only apply to the trace
+    if ((opts->filter != NULL || opts->delta) && !*exec_trace) {
+        memset(opts, 0x00, sizeof(exec_opts_t));
+        usage_p4(argv);
+        return false;
+    }
+
+    // a run either reads its input or replays it
+    if (opts->input_record != NULL && opts->input_replay != NULL) {
+        memset(opts, 0x00, sizeof(exec_opts_t));
+        usage_p4(argv);
+        return false;
+    }
+
+    // lockstep drives the run itself, so it replaces the debugger and
+    // checkpointing loops
+    if (opts->lockstep != NULL
+          && (!*exec_normal || opts->gdb != NULL || opts->ckpt_file != NULL)) {
+        memset(opts, 0x00, sizeof(exec_opts_t));
+        usage_p4(argv);
+        return false;
+    }
 
     // load filename
     *filename = argv[optind];
@@ -332,13 +519,37 @@ bool parse_command_line_p4 (int argc, char **argv,
     // return true if valid options were selected
     // note that -h is a special case
     if (H_selected || s_selected || m_selected || M_selected || d_selected ||
-          D_selected || e_selected || E_selected) {
+          D_selected || e_selected || E_selected || opts->coverage != NULL) {
         return true;
     }
 
     return false;
 }
 
+void set_input_hook (input_hook_t hook, void *arg)
+{
+    input_hook = hook;
+    input_hook_arg = arg;
+}
+
+void set_iotrap_out (FILE *out)
+{
+    iotrap_out = out;
+}
+
+int iotrap_read_input (y86_iotrap_t trap, int *value)
+{
+    if (trap == CHARIN) {
+        char ch;
+        int result = scanf("%c", &ch);
+        if (result == 1) {
+            *value = (byte_t) ch;
+        }
+        return result;
+    }
+    return scanf("%d", value);
+}
+
 void dump_cpu_state (y86_t cpu)
 {
     // print flags
@@ -373,7 +584,8 @@ void dump_cpu_state (y86_t cpu)
  */
 y86_reg_t get_reg(y86_t *cpu, y86_regnum_t reg_num)
 {
-    return cpu->reg[reg_num];
+    // register F means no register, which reads as zero
+    return reg_num < NUMREGS ? cpu->reg[reg_num] : 0;
 }
 
 /**
@@ -480,13 +692,14 @@ y86_reg_t op(y86_t *cpu, y86_inst_t inst, y86_reg_t valA, y86_reg_t valB)
     
     switch(inst.ifun.op) {
         case(ADD):
-            sigValE = sigValB + sigValA;
+            // wrap in unsigned arithmetic; signed overflow is undefined
+            sigValE = (int64_t) (valB + valA);
             // set overflow flag for addition
             cpu->of = (sigValB < 0 && sigValA < 0 && sigValE > 0) || (sigValB > 0 && sigValA > 0 && sigValE < 0);
             valE = sigValE;
             break;
         case(SUB):
-            sigValE = sigValB - sigValA;
+            sigValE = (int64_t) (valB - valA);
             // set overflow flag for subtraction
             cpu->of = ((sigValB < 0 && sigValA > 0 && sigValE > 0) || (sigValB > 0 && sigValA < 0 && sigValE < 0 )); 
             valE = sigValE;
@@ -514,7 +727,10 @@ y86_reg_t op(y86_t *cpu, y86_inst_t inst, y86_reg_t valA, y86_reg_t valB)
  */
 void write_back(y86_t *cpu, y86_regnum_t reg, y86_reg_t val)
 {
-    cpu->reg[reg] = val;
+    // writes to register F (no register) are dropped
+    if (reg < NUMREGS) {
+        cpu->reg[reg] = val;
+    }
 }
 
 /**
@@ -522,61 +738,60 @@ void write_back(y86_t *cpu, y86_regnum_t reg, y86_reg_t val)
  */
 void iotrap(y86_t *cpu, y86_inst_t inst, byte_t *memory)
 {
+    byte_t old = memory[RDI];
+    FILE *out = (iotrap_out != NULL) ? iotrap_out : stdout;
+
     // what the frick is this
     switch (inst.ifun.trap) {
         case CHAROUT: // 0
             break;
-        case CHARIN: // 1
-            scanf("%c", &memory[RDI]);
+        case CHARIN:; // 1
+            int ch;
+            if (iotrap_input(CHARIN, &ch) == 1) {
+                memory[RDI] = ch;
+            }
+            mem_watch(ACCESS_WRITE, cpu->pc, RDI, old, memory[RDI], 1);
+            mem_store(RDI, old, memory[RDI], 1);
             break;
         case DECOUT: // 2
             //snprintf(buffer, sizeof(int64_t), "%d", (int) &memory[RSI]);
             break;
         case DECIN:; // 3
             int input;
-            int result = scanf("%d", &input);
+            int result = iotrap_input(DECIN, &input);
+            if (result == INPUT_NONE) {
+                break;
+            }
             if (result == EOF || result == 0) {
-                printf("I/O Error");
+                fprintf(out, "I/O Error");
                 cpu->stat = HLT;
                 break;
             }
             memory[RDI] = input;
+            mem_watch(ACCESS_WRITE, cpu->pc, RDI, old, memory[RDI], 1);
+            mem_store(RDI, old, memory[RDI], 1);
             break;
         case STROUT: // 4
             break;
         case FLUSH: // 5
-            fwrite(buffer, sizeof(char), 100, stdout);
+            fwrite(buffer, sizeof(char), IOBUF_SIZE, out);
             memset(buffer, 0, sizeof(char));
             break;
         case BADTRAP:
-            printf("I/O Error");
+            fprintf(out, "I/O Error");
             cpu->stat = HLT;
             return;
     }
 }
 
 /**
- * get the byte size of the instruction
+ * read the value for an input trap from the input hook, or from standard input
+ * if there is none
  */
-size_t inst_size(y86_inst_t inst)
+int iotrap_input(y86_iotrap_t trap, int *value)
 {
-    switch (inst.icode) {
-        case INVALID:
-            return 0;
-        case HALT:
-        case NOP:
-        case RET:
-        case IOTRAP:
-            return 1; // 1 byte instructions
-        case CMOV:
-        case OPQ:
-        case PUSHQ:
-        case POPQ:
-            return 2; // 2 byte instructions
-        case JUMP:
-        case CALL:
-            return 9; // 9 byte instructions
-        default:
-            return 10; // 10 byte instructions
+    if (input_hook != NULL) {
+        return input_hook(input_hook_arg, trap, value);
     }
+    return iotrap_read_input(trap, value);
 }
@@ -10,8 +10,69 @@
 #include <unistd.h>
 
 #include "elf.h"
+#include "memhook.h"
 #include "y86.h"
 
+/* size of the output buffer used by the I/O traps */
+#define IOBUF_SIZE 100
+
+/* I/O trap output buffer (written out by FLUSH) */
+extern char buffer[IOBUF_SIZE];
+
+/* what an input read returns when it was refused: the trap reads nothing and
+   does not fail (scanf's own results are 1, 0 and EOF) */
+#define INPUT_NONE (-2)
+
+/* callback that supplies the value for a CHARIN or DECIN trap in place of
+   standard input; returns what scanf would (1 with *value set, 0 if DECIN
+   found no number, EOF at end of input) or INPUT_NONE */
+typedef int (*input_hook_t) (void *arg, y86_iotrap_t trap, int *value);
+
+/* currently installed input hook (NULL to read standard input) and its
+   argument; like the memory hooks, each thread has its own */
+extern __thread input_hook_t input_hook;
+extern __thread void *input_hook_arg;
+
+/* stream the I/O traps write the guest's output to on this thread (NULL for
+   standard out, looked up at each write) */
+extern __thread FILE *iotrap_out;
+
+/* most watchpoints that can be given on the command line */
+#define MAX_WATCHES 16
+
+/* optional analysis settings for execution (-e and -E) */
+typedef struct exec_opts {
+
+    bool pipe;                  // report PIPE timing model statistics (-P)
+    char *bpred;                // branch predictor specification (-B)
+    char *cache;                // cache hierarchy specification (-C)
+    char *ooo;                  // out-of-order model specification (-O)
+    bool critpath;              // report the dataflow critical path (-c)
+    char *sample;               // sampled simulation specification (-S)
+    uint64_t limit;             // instruction limit, 0 for none (-l)
+    double timeout;             // wall-clock limit in seconds, 0 for none (-t)
+    bool loops;                 // stop when the machine state repeats (-L)
+    uint64_t ckpt_every;        // instructions between checkpoints (-k)
+    char *ckpt_file;            // checkpoint file to write (-k)
+    char *restore;              // checkpoint file to resume from (-r)
+    bool changes;               // report only memory changed by the run (-x)
+    char *journal;              // undo journal specification (-j)
+    bool rewind;                // rewind after the run (-b)
+    uint64_t rewind_to;         // instruction count to rewind to (-b)
+    char *gdb;                  // debugger port or socket path (-g)
+    char *watch[MAX_WATCHES];   // watchpoint specifications (-w)
+    int nwatch;
+    char *memtrace;             // memory-access trace file to write (-T)
+    bool async;                 // write output from a background thread (-A)
+    char *filter;               // trace filter specification (-F)
+    bool delta;                 // print only what each instruction changed (-z)
+    char *coverage;             // coverage files to merge and write (-V)
+    char *lockstep;             // lockstep check specification (-K)
+    char *input_record;         // input log to record (-I)
+    char *input_replay;         // input log to replay (-i)
+
+} exec_opts_t;
+
 /**
  * @brief Read register values and execute ALU operation
  *
@@ -57,6 +118,7 @@ void usage_p4 (char **argv);
  * @param disas_data Pointer to boolean flag for disassembling data segments
  * @param exec_normal Pointer to boolean flag for executing the program normally
  * @param exec_debug Pointer to boolean flag for executing the program w/ debug tracing
+ * @param opts Pointer to optional execution analysis settings
  * @param filename Pointer to string buffer for Mini-ELF filename
  * @returns True if the command-line options were valid, false if not
  */
@@ -64,7 +126,36 @@ bool parse_command_line_p4 (int argc, char **argv,
         bool *print_header, bool *print_segments,
         bool *print_membrief, bool *print_memfull,
         bool *disas_code, bool *disas_data,
-        bool *exec_normal, bool *exec_debug, char **filename);
+        bool *exec_normal, bool *exec_debug, exec_opts_t *opts,
+        char **filename);
+
+/**
+ * @brief Install or remove the input hook for this thread
+ *
+ * @param hook Callback to supply input trap values, or NULL to read standard
+ *        input
+ * @param arg Argument passed through to every callback
+ */
+void set_input_hook (input_hook_t hook, void *arg);
+
+/**
+ * @brief Send the guest's output from the I/O traps on this thread to a
+ * stream
+ *
+ * @param out Stream for FLUSH and I/O error output, or NULL for standard out
+ */
+void set_iotrap_out (FILE *out);
+
+/**
+ * @brief Read one input trap value from standard input, as the traps do
+ * without an input hook
+ *
+ * @param trap CHARIN (one character) or DECIN (a decimal number)
+ * @param value Value read
+ * @returns The scanf result: 1 if a value was read, 0 if DECIN found no
+ *          number, EOF at end of input
+ */
+int iotrap_read_input (y86_iotrap_t trap, int *value);
 
 /**
  * @brief Print info about a Y86 CPU to standard out
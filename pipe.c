@@ -0,0 +1,126 @@
+/*
+ * CS 261: PIPE timing model
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "pipe.h"
+
+void get_srcs(y86_inst_t inst, y86_regnum_t *srcA, y86_regnum_t *srcB);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+void pipe_init (pipe_t *pipe)
+{
+    memset(pipe, 0x00, sizeof(pipe_t));
+    pipe->dstM = NOREG;
+}
+
+void pipe_step (pipe_t *pipe, y86_inst_t inst, bool cnd)
+{
+    y86_regnum_t srcA;
+    y86_regnum_t srcB;
+
+    pipe->insts++;
+
+    // a load feeding the very next instruction cannot be forwarded in time,
+    // so decode stalls for one cycle and a bubble is injected into execute
+    get_srcs(inst, &srcA, &srcB);
+    if (pipe->dstM != NOREG && (srcA == pipe->dstM || srcB == pipe->dstM)) {
+        pipe->load_use++;
+    }
+
+    // remember the load destination for the next instruction
+    if (inst.icode == MRMOVQ || inst.icode == POPQ) {
+        pipe->dstM = inst.ra;
+    } else {
+        pipe->dstM = NOREG;
+    }
+
+    // branches are predicted taken, so a conditional jump that falls
+    // through squashes the two instructions fetched from the target
+    if (inst.icode == JUMP && inst.ifun.jump != JMP && !cnd) {
+        pipe->mispredicts++;
+    }
+
+    // the return address is not known until ret reaches write-back
+    if (inst.icode == RET) {
+        pipe->rets++;
+    }
+}
+
+uint64_t pipe_cycles (pipe_t *pipe)
+{
+    if (pipe->insts == 0) {
+        return 0;
+    }
+
+    return PIPE_FILL + pipe->insts
+        + pipe->load_use * LOAD_USE_BUBBLES
+        + pipe->mispredicts * MISPREDICT_BUBBLES
+        + pipe->rets * RET_BUBBLES;
+}
+
+void dump_pipe_stats (pipe_t *pipe)
+{
+    uint64_t cycles = pipe_cycles(pipe);
+    double cpi = 0.0;
+
+    if (pipe->insts > 0) {
+        cpi = (double) cycles / pipe->insts;
+    }
+
+    printf("PIPE timing model:\n");
+    printf("  Cycles: %" PRIu64 "   Instructions: %" PRIu64 "   CPI: %.3f\n",
+            cycles, pipe->insts, cpi);
+    printf("  Pipeline fill:      %8d cycles\n", pipe->insts > 0 ? PIPE_FILL : 0);
+    printf("  Load/use stalls:    %8" PRIu64 " cycles (%" PRIu64 " hazards)\n",
+            pipe->load_use * LOAD_USE_BUBBLES, pipe->load_use);
+    printf("  Mispredict bubbles: %8" PRIu64 " cycles (%" PRIu64 " branches)\n",
+            pipe->mispredicts * MISPREDICT_BUBBLES, pipe->mispredicts);
+    printf("  Return bubbles:     %8" PRIu64 " cycles (%" PRIu64 " returns)\n",
+            pipe->rets * RET_BUBBLES, pipe->rets);
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * get the registers read in the decode stage (srcA and srcB in PIPE)
+ */
+void get_srcs(y86_inst_t inst, y86_regnum_t *srcA, y86_regnum_t *srcB)
+{
+    *srcA = NOREG;
+    *srcB = NOREG;
+
+    switch (inst.icode) {
+        case CMOV:
+            *srcA = inst.ra;
+            break;
+        case RMMOVQ:
+        case OPQ:
+            *srcA = inst.ra;
+            *srcB = inst.rb;
+            break;
+        case MRMOVQ:
+            *srcB = inst.rb;
+            break;
+        case CALL:
+            *srcB = RSP;
+            break;
+        case RET:
+        case POPQ:
+            *srcA = RSP;
+            *srcB = RSP;
+            break;
+        case PUSHQ:
+            *srcA = inst.ra;
+            *srcB = RSP;
+            break;
+        default:
+            break;
+    }
+}
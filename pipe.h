@@ -0,0 +1,63 @@
+#ifndef __CS261_PIPE__
+#define __CS261_PIPE__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "y86.h"
+
+/* number of cycles needed to fill the F/D/E/M/W pipeline before the first
+   instruction completes */
+#define PIPE_FILL 4
+
+/* bubbles inserted by the PIPE hazard control logic */
+#define LOAD_USE_BUBBLES 1
+#define MISPREDICT_BUBBLES 2
+#define RET_BUBBLES 3
+
+/* PIPE timing model state and statistics */
+typedef struct pipe {
+
+    uint64_t insts;             // instructions that reached write-back
+    uint64_t load_use;          // load/use hazards (stall + bubble)
+    uint64_t mispredicts;       // not-taken conditional jumps
+    uint64_t rets;              // ret instructions
+
+    y86_regnum_t dstM;          // load destination of previous instruction
+
+} pipe_t;
+
+/**
+ * @brief Reset a PIPE timing model
+ *
+ * @param pipe Pipeline model to reset
+ */
+void pipe_init (pipe_t *pipe);
+
+/**
+ * @brief Account for one instruction that completed on the functional path
+ *
+ * @param pipe Pipeline model to update
+ * @param inst Y86 instruction structure for the completed instruction
+ * @param cnd Condition computed in the execute phase (jumps and moves)
+ */
+void pipe_step (pipe_t *pipe, y86_inst_t inst, bool cnd);
+
+/**
+ * @brief Total cycles the program took on the pipeline
+ *
+ * @param pipe Pipeline model to query
+ * @returns Number of clock cycles, including pipeline fill
+ */
+uint64_t pipe_cycles (pipe_t *pipe);
+
+/**
+ * @brief Print cycles, CPI and the stall/bubble breakdown to standard out
+ *
+ * @param pipe Pipeline model to print
+ */
+void dump_pipe_stats (pipe_t *pipe);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * CS 261: Sampled simulation
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "sample.h"
+
+/* two-sided 95% quantile of the normal distribution */
+#define Z_95 1.96
+
+void *sample_worker(void *arg);
+void sample_measure(sampler_t *s, sample_job_t *job, sample_result_t *result);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool sample_init (sampler_t *s, const char *spec)
+{
+    long interval = 0;
+    long window = SAMPLE_WINDOW;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // check for bad parameters
+    if (s == NULL || spec == NULL) {
+        return false;
+    }
+
+    memset(s, 0x00, sizeof(sampler_t));
+
+    // note where each field ended, so nothing may follow the last one
+    int ends[3] = { 0, 0, 0 };
+    int fields = sscanf(spec, "%ld%n:%ld%n:%ld%n", &interval, &ends[0],
+            &window, &ends[1], &nthreads, &ends[2]);
+    if (fields < 1 || spec[ends[fields - 1]] != '\0') {
+        return false;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (interval < 1 || window < 1 || window > interval
+          || nthreads > SAMPLE_MAX_THREADS) {
+        return false;
+    }
+
+    s->interval = interval;
+    s->window = window;
+    s->nthreads = nthreads;
+    s->queue_size = 2 * nthreads;
+    s->queue = (sample_job_t**)calloc(s->queue_size, sizeof(sample_job_t*));
+    if (s->queue == NULL) {
+        return false;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->not_empty, NULL);
+    pthread_cond_init(&s->not_full, NULL);
+
+    for (int i = 0; i < s->nthreads; i++) {
+        if (pthread_create(&s->threads[i], NULL, sample_worker, s) != 0) {
+            s->nthreads = i;
+            sample_finish(s);
+            sample_free(s);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void sample_checkpoint (sampler_t *s, y86_t *cpu, byte_t *memory)
+{
+    sample_job_t *job = (sample_job_t*)malloc(sizeof(sample_job_t));
+
+    s->next += s->interval;
+    if (job == NULL) {
+        return;
+    }
+
+    job->cpu = *cpu;
+    memcpy(job->memory, memory, MEMSIZE);
+
+    pthread_mutex_lock(&s->lock);
+
+    // make room for the result before any worker can finish it
+    if (s->samples == s->results_cap) {
+        uint64_t cap = s->results_cap > 0 ? 2 * s->results_cap : 64;
+        sample_result_t *grown = (sample_result_t*)realloc(s->results,
+                cap * sizeof(sample_result_t));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&s->lock);
+            free(job);
+            return;
+        }
+        s->results = grown;
+        s->results_cap = cap;
+    }
+    job->index = s->samples++;
+
+    while (s->queue_count == s->queue_size) {
+        pthread_cond_wait(&s->not_full, &s->lock);
+    }
+    s->queue[(s->queue_head + s->queue_count) % s->queue_size] = job;
+    s->queue_count++;
+    pthread_cond_signal(&s->not_empty);
+
+    pthread_mutex_unlock(&s->lock);
+}
+
+void sample_finish (sampler_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->done = true;
+    pthread_cond_broadcast(&s->not_empty);
+    pthread_mutex_unlock(&s->lock);
+
+    for (int i = 0; i < s->nthreads; i++) {
+        pthread_join(s->threads[i], NULL);
+    }
+    s->nthreads = 0;
+}
+
+void sample_free (sampler_t *s)
+{
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->not_empty);
+    pthread_cond_destroy(&s->not_full);
+    free(s->queue);
+    free(s->results);
+    memset(s, 0x00, sizeof(sampler_t));
+}
+
+void dump_sample_stats (sampler_t *s, uint64_t insts)
+{
+    uint64_t measured = 0;
+    uint64_t n = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+
+    // per-window CPI, ignoring windows cut short before any instruction
+    for (uint64_t i = 0; i < s->samples; i++) {
+        if (s->results[i].insts == 0) {
+            continue;
+        }
+        double cpi = (double) s->results[i].cycles / s->results[i].insts;
+        sum += cpi;
+        sum_sq += cpi * cpi;
+        measured += s->results[i].insts;
+        n++;
+    }
+
+    printf("Sampled PIPE estimate (interval %" PRIu64 ", window %" PRIu64 "):\n",
+            s->interval, s->window);
+    printf("  Samples: %" PRIu64 "   Measured instructions: %" PRIu64 " (%.2f%%)\n",
+            n, measured, insts > 0 ? 100.0 * measured / insts : 0.0);
+    if (n == 0) {
+        return;
+    }
+
+    double mean = sum / n;
+    double half = 0.0;
+    if (n > 1) {
+        double var = (sum_sq - n * mean * mean) / (n - 1);
+        half = Z_95 * sqrt(var > 0.0 ? var : 0.0) / sqrt((double) n);
+    }
+
+    printf("  CPI: %.3f +/- %.3f (95%% confidence)\n", mean, half);
+    printf("  Estimated cycles: %.0f (95%% CI %.0f to %.0f)\n",
+            PIPE_FILL + mean * insts,
+            PIPE_FILL + (mean - half) * insts,
+            PIPE_FILL + (mean + half) * insts);
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * worker thread: measure queued checkpoints until the sampler is done
+ */
+void *sample_worker(void *arg)
+{
+    sampler_t *s = (sampler_t*)arg;
+
+    while (true) {
+        pthread_mutex_lock(&s->lock);
+        while (s->queue_count == 0 && !s->done) {
+            pthread_cond_wait(&s->not_empty, &s->lock);
+        }
+        if (s->queue_count == 0) {
+            pthread_mutex_unlock(&s->lock);
+            return NULL;
+        }
+        sample_job_t *job = s->queue[s->queue_head];
+        s->queue_head = (s->queue_head + 1) % s->queue_size;
+        s->queue_count--;
+        pthread_cond_signal(&s->not_full);
+        pthread_mutex_unlock(&s->lock);
+
+        sample_result_t result;
+        sample_measure(s, job, &result);
+
+        pthread_mutex_lock(&s->lock);
+        s->results[job->index] = result;
+        pthread_mutex_unlock(&s->lock);
+
+        free(job);
+    }
+}
+
+/**
+ * run one window from a checkpoint on the worker's private copy, feeding
+ * the PIPE model; I/O traps are skipped so workers never touch stdio
+ */
+void sample_measure(sampler_t *s, sample_job_t *job, sample_result_t *result)
+{
+    y86_t *cpu = &job->cpu;
+    pipe_t pipe;
+
+    pipe_init(&pipe);
+
+    for (uint64_t n = 0; n < s->window && cpu->stat == AOK; n++) {
+        bool cnd = false;
+        y86_reg_t valA = 0;
+        y86_reg_t valE = 0;
+        y86_inst_t inst = fetch(cpu, job->memory);
+
+        if (cpu->stat != AOK) {
+            break;
+        }
+
+        if (inst.icode == IOTRAP) {
+            cpu->pc = inst.valP;
+        } else {
+            valE = decode_execute(cpu, inst, &cnd, &valA);
+            memory_wb_pc(cpu, inst, job->memory, cnd, valA, valE);
+        }
+        pipe_step(&pipe, inst, cnd);
+
+        if (cpu->pc >= MEMSIZE) {
+            break;
+        }
+    }
+
+    // report steady-state cycles; the fill is added once for the program
+    result->insts = pipe.insts;
+    result->cycles = pipe.insts > 0 ? pipe_cycles(&pipe) - PIPE_FILL : 0;
+}
@@ -0,0 +1,110 @@
+#ifndef __CS261_SAMPLE__
+#define __CS261_SAMPLE__
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "p3-disas.h"
+#include "p4-interp.h"
+#include "pipe.h"
+#include "y86.h"
+
+/* defaults and limits for the sampling parameters */
+#define SAMPLE_WINDOW 1000
+#define SAMPLE_MAX_THREADS 64
+
+/* checkpoint of the machine handed to a worker */
+typedef struct sample_job {
+
+    uint64_t index;             // sample number
+    y86_t cpu;                  // CPU state at the checkpoint
+    byte_t memory[MEMSIZE];     // guest memory at the checkpoint
+
+} sample_job_t;
+
+/* detailed measurement of one window */
+typedef struct sample_result {
+
+    uint64_t insts;             // instructions measured in the window
+    uint64_t cycles;            // steady-state PIPE cycles for the window
+
+} sample_result_t;
+
+/* sampled simulation driver: checkpoints from the functional loop are
+   measured with the PIPE model by a pool of worker threads */
+typedef struct sampler {
+
+    uint64_t interval;          // instructions between checkpoints
+    uint64_t window;            // instructions measured after each checkpoint
+    int nthreads;               // number of worker threads
+    uint64_t next;              // instruction count of the next checkpoint
+
+    pthread_t threads[SAMPLE_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+
+    sample_job_t **queue;       // bounded ring of pending checkpoints
+    int queue_size;
+    int queue_head;
+    int queue_count;
+    bool done;                  // no more checkpoints will be queued
+
+    sample_result_t *results;   // measurements, indexed by sample number
+    uint64_t samples;           // checkpoints taken
+    uint64_t results_cap;
+
+} sampler_t;
+
+/**
+ * @brief Start a sampler from a command-line specification
+ *
+ * The specification has the form interval[:window[:threads]]; the thread
+ * count defaults to the number of online processors.
+ *
+ * @param s Sampler to initialize
+ * @param spec Sampling specification string
+ * @returns True if the specification was valid and the workers started
+ */
+bool sample_init (sampler_t *s, const char *spec);
+
+/**
+ * @brief Queue a checkpoint of the current machine state for measurement
+ *
+ * Blocks while every worker is busy and the queue is full.
+ *
+ * @param s Sampler to use
+ * @param cpu CPU state to copy
+ * @param memory Guest memory to copy
+ */
+void sample_checkpoint (sampler_t *s, y86_t *cpu, byte_t *memory);
+
+/**
+ * @brief Wait for all queued checkpoints to be measured and stop the workers
+ *
+ * @param s Sampler to finish
+ */
+void sample_finish (sampler_t *s);
+
+/**
+ * @brief Release the queue and results of a finished sampler
+ *
+ * @param s Sampler to free
+ */
+void sample_free (sampler_t *s);
+
+/**
+ * @brief Print the whole-program cycle estimate and its confidence interval
+ *
+ * @param s Finished sampler
+ * @param insts Total instructions executed by the functional run
+ */
+void dump_sample_stats (sampler_t *s, uint64_t insts);
+
+#endif
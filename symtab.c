@@ -0,0 +1,125 @@
+/*
+ * CS 261: Mini-ELF symbol table
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "symtab.h"
+
+int compare_symbols(const void *a, const void *b);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool symtab_load (symtab_t *t, FILE *file, elf_hdr_t *hdr)
+{
+    symtab_free(t);
+
+    if (hdr->e_symtab == 0 || hdr->e_strtab <= hdr->e_symtab) {
+        return true;
+    }
+
+    // the string table runs to the end of the file
+    t->strings = (char*)calloc(SYMTAB_MAX_STRINGS + 1, 1);
+    if (t->strings == NULL) {
+        return false;
+    }
+    size_t len = 0;
+    if (fseek(file, hdr->e_strtab, SEEK_SET) == 0) {
+        len = fread(t->strings, 1, SYMTAB_MAX_STRINGS, file);
+    }
+
+    int count = (hdr->e_strtab - hdr->e_symtab) / sizeof(elf_sym_t);
+    t->syms = (symbol_t*)calloc(count, sizeof(symbol_t));
+    if (t->syms == NULL) {
+        symtab_free(t);
+        return false;
+    }
+    if (fseek(file, hdr->e_symtab, SEEK_SET) != 0) {
+        symtab_free(t);
+        return true;
+    }
+
+    for (int i = 0; i < count; i++) {
+        elf_sym_t sym;
+        if (fread(&sym, sizeof(elf_sym_t), 1, file) != 1) {
+            break;
+        }
+        // skip entries whose names fall outside the string table
+        if (sym.st_name < len && t->strings[sym.st_name] != '\0') {
+            t->syms[t->count].addr = sym.st_value;
+            t->syms[t->count].name = &t->strings[sym.st_name];
+            t->count++;
+        }
+    }
+
+    qsort(t->syms, t->count, sizeof(symbol_t), compare_symbols);
+
+    return true;
+}
+
+void symtab_free (symtab_t *t)
+{
+    free(t->syms);
+    free(t->strings);
+    memset(t, 0x00, sizeof(symtab_t));
+}
+
+symbol_t *symtab_find (symtab_t *t, address_t addr)
+{
+    int lo = 0;
+    int hi = t->count;
+
+    // binary search for the last symbol at or below addr
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (t->syms[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo > 0 ? &t->syms[lo - 1] : NULL;
+}
+
+bool symtab_resolve (symtab_t *t, const char *str, address_t *addr)
+{
+    char *end;
+
+    if (*str == '\0') {
+        return false;
+    }
+
+    *addr = strtoull(str, &end, 0);
+    if (*end == '\0' && *str != '-') {
+        return true;
+    }
+
+    for (int i = 0; i < t->count; i++) {
+        if (strcmp(t->syms[i].name, str) == 0) {
+            *addr = t->syms[i].addr;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * order symbols by address, then name, for qsort
+ */
+int compare_symbols(const void *a, const void *b)
+{
+    const symbol_t *sa = (const symbol_t*)a;
+    const symbol_t *sb = (const symbol_t*)b;
+
+    if (sa->addr != sb->addr) {
+        return sa->addr < sb->addr ? -1 : 1;
+    }
+    return strcmp(sa->name, sb->name);
+}
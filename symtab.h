@@ -0,0 +1,72 @@
+#ifndef __CS261_SYMTAB__
+#define __CS261_SYMTAB__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elf.h"
+#include "y86.h"
+
+/* longest string table read from an image */
+#define SYMTAB_MAX_STRINGS (1 << 16)
+
+/* one named address */
+typedef struct symbol {
+
+    address_t addr;
+    const char *name;           // points into the table's strings
+
+} symbol_t;
+
+/* symbols of a loaded image, sorted by address */
+typedef struct symtab {
+
+    symbol_t *syms;
+    int count;
+    char *strings;              // copy of the string table
+
+} symtab_t;
+
+/**
+ * @brief Read the symbol table of a Mini-ELF file
+ *
+ * An image without a symbol table, or with one that does not fit inside
+ * the file, gets an empty table.
+ *
+ * @param t Table to fill (previous contents are freed)
+ * @param file Open Mini-ELF file
+ * @param hdr Header of the file
+ * @returns False only if allocation failed
+ */
+bool symtab_load (symtab_t *t, FILE *file, elf_hdr_t *hdr);
+
+/**
+ * @brief Release a symbol table
+ *
+ * @param t Table to free
+ */
+void symtab_free (symtab_t *t);
+
+/**
+ * @brief Find the symbol an address belongs to
+ *
+ * @param t Table to search
+ * @param addr Address to look up
+ * @returns The symbol with the highest address not above addr, or NULL
+ */
+symbol_t *symtab_find (symtab_t *t, address_t addr);
+
+/**
+ * @brief Turn a number or a symbol name into an address
+ *
+ * @param t Table to search
+ * @param str Address (any base strtoull accepts) or symbol name
+ * @param addr Out: the address
+ * @returns False if str is neither a number nor a known symbol
+ */
+bool symtab_resolve (symtab_t *t, const char *str, address_t *addr);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * CS 261: Trace filter
+ *
+ * Name: Dylan Moreno
+ */
+
+#include "tracefilter.h"
+
+/* names accepted by icode=, indexed by y86_icode_t */
+const char *ICODE_NAMES[] = {
+    "halt", "nop", "cmov", "irmovq", "rmmovq", "mrmovq", "opq", "jump",
+    "call", "ret", "pushq", "popq", "iotrap"
+};
+
+bool tracefilter_parse_entry(tracefilter_t *f, char *entry, symtab_t *symbols);
+bool tracefilter_parse_count(const char *str, uint64_t *count);
+bool tracefilter_done(tracefilter_t *f, machine_t *m);
+
+/**********************************************************************
+ *                         REQUIRED FUNCTIONS
+ *********************************************************************/
+
+bool tracefilter_init (tracefilter_t *f, const char *spec, symtab_t *symbols)
+{
+    // check for bad parameters
+    if (f == NULL || spec == NULL) {
+        return false;
+    }
+
+    memset(f, 0x00, sizeof(tracefilter_t));
+    f->last = UINT64_MAX;
+    f->every = 1;
+
+    char copy[256];
+    if (strlen(spec) >= sizeof(copy)) {
+        return false;
+    }
+    strcpy(copy, spec);
+
+    for (char *entry = strtok(copy, ","); entry != NULL; entry = strtok(NULL, ",")) {
+        if (!tracefilter_parse_entry(f, entry, symbols)) {
+            return false;
+        }
+    }
+
+    // without a start address, tracing is armed from the beginning
+    f->in_range = !f->has_from;
+
+    return f->first < f->last && f->every > 0;
+}
+
+bool tracefilter_select (tracefilter_t *f, machine_t *m, y86_inst_t *inst)
+{
+    address_t pc = m->cpu.pc;
+
+    if (f->has_from && !f->in_range && pc == f->from) {
+        f->in_range = true;
+    }
+
+    // faults are always shown, whatever their icode
+    bool selected = f->in_range && m->count >= f->first && m->count < f->last
+        && (f->icodes == 0 || m->cpu.stat != AOK
+            || (inst->icode < INVALID && (f->icodes & (1u << inst->icode))));
+
+    // the stop address itself is still traced
+    if (f->has_to && f->in_range && pc == f->to) {
+        f->in_range = false;
+    }
+
+    if (selected) {
+        selected = f->seen % f->every == 0;
+        f->seen++;
+    }
+    return selected;
+}
+
+bool tracefilter_waiting (tracefilter_t *f, machine_t *m)
+{
+    if (tracefilter_done(f, m)) {
+        return true;
+    }
+
+    // the filter has to see its own addresses to switch tracing on and off
+    if (f->has_from && !f->in_range && m->cpu.pc == f->from) {
+        return false;
+    }
+    if (f->has_to && f->in_range && m->cpu.pc == f->to) {
+        return false;
+    }
+
+    return m->count < f->first || !f->in_range;
+}
+
+void tracefilter_skip (tracefilter_t *f, machine_t *m, uint64_t budget)
+{
+    bool done = tracefilter_done(f, m);
+
+    // stop where the window opens ...
+    if (!done && m->count < f->first
+          && (budget == 0 || f->first - m->count < budget)) {
+        budget = f->first - m->count;
+    }
+
+    // ... or where tracing would be switched on or off
+    bool break_from = !done && f->has_from && !f->in_range
+        && !machine_is_break(m, f->from);
+    bool break_to = !done && f->has_to && f->in_range
+        && !machine_is_break(m, f->to);
+    if (break_from) {
+        break_from = machine_set_break(m, f->from, true);
+    }
+    if (break_to) {
+        break_to = machine_set_break(m, f->to, true);
+    }
+
+    fetch_hook_t hook = m->fetch_hook;
+    machine_set_hooks(m, NULL, m->exec_hook, m->block_hook, m->hook_arg);
+    machine_run(m, budget);
+    machine_set_hooks(m, hook, m->exec_hook, m->block_hook, m->hook_arg);
+
+    if (break_from) {
+        machine_set_break(m, f->from, false);
+    }
+    if (break_to) {
+        machine_set_break(m, f->to, false);
+    }
+    if (m->stop == STOP_BREAK) {
+        m->stop = STOP_NONE;
+    }
+}
+
+/**********************************************************************
+ *                         HELPER FUNCTIONS
+ *********************************************************************/
+
+/**
+ * parse one key=value entry of a trace filter specification
+ */
+bool tracefilter_parse_entry(tracefilter_t *f, char *entry, symtab_t *symbols)
+{
+    char *value = strchr(entry, '=');
+    if (value == NULL) {
+        return false;
+    }
+    *value++ = '\0';
+
+    if (strcmp(entry, "from") == 0) {
+        f->has_from = symtab_resolve(symbols, value, &f->from);
+        return f->has_from;
+    } else if (strcmp(entry, "to") == 0) {
+        f->has_to = symtab_resolve(symbols, value, &f->to);
+        return f->has_to;
+    } else if (strcmp(entry, "window") == 0) {
+        char *colon = strchr(value, ':');
+        if (colon == NULL) {
+            return false;
+        }
+        *colon++ = '\0';
+        return (*value == '\0' || tracefilter_parse_count(value, &f->first))
+            && (*colon == '\0' || tracefilter_parse_count(colon, &f->last));
+    } else if (strcmp(entry, "every") == 0) {
+        return tracefilter_parse_count(value, &f->every);
+    } else if (strcmp(entry, "icode") == 0) {
+        char *save;
+        for (char *name = strtok_r(value, "+", &save); name != NULL;
+                name = strtok_r(NULL, "+", &save)) {
+            int i = 0;
+            while (i < INVALID && strcmp(name, ICODE_NAMES[i]) != 0) {
+                i++;
+            }
+            if (i == INVALID) {
+                return false;
+            }
+            f->icodes |= 1u << i;
+        }
+        return f->icodes != 0;
+    }
+    return false;
+}
+
+/**
+ * parse a non-negative decimal instruction count
+ */
+bool tracefilter_parse_count(const char *str, uint64_t *count)
+{
+    char *end;
+
+    if (*str < '0' || *str > '9') {
+        return false;
+    }
+    *count = strtoull(str, &end, 10);
+    return *end == '\0';
+}
+
+/**
+ * nothing after this point can be selected
+ */
+bool tracefilter_done(tracefilter_t *f, machine_t *m)
+{
+    return m->count >= f->last || (!f->in_range && !f->has_from);
+}
@@ -0,0 +1,89 @@
+#ifndef __CS261_TRACEFILTER__
+#define __CS261_TRACEFILTER__
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "symtab.h"
+#include "y86.h"
+
+/* which instructions of a trace are printed */
+typedef struct tracefilter {
+
+    bool has_from;              // tracing starts at from ...
+    address_t from;
+    bool has_to;                // ... and stops after to (re-armed at from)
+    address_t to;
+    bool in_range;              // between from and to
+
+    uint64_t first;             // instruction-count window [first, last)
+    uint64_t last;
+    uint64_t every;             // print every Nth selected instruction
+    uint64_t seen;              // instructions selected so far
+    uint32_t icodes;            // bit per icode to print (0 for all)
+
+} tracefilter_t;
+
+/**
+ * @brief Parse a trace filter specification
+ *
+ * The specification is a comma-separated list of
+ *
+ *     from=ADDR    start tracing at each execution of ADDR
+ *     to=ADDR      stop tracing after each execution of ADDR
+ *     window=A:B   only instructions A to B-1, counted from zero (either
+ *                  bound may be left out)
+ *     every=N      only every Nth instruction that passes the other filters
+ *     icode=I+I    only these instruction kinds (halt, nop, cmov, irmovq,
+ *                  rmmovq, mrmovq, opq, jump, call, ret, pushq, popq, iotrap)
+ *
+ * where ADDR is a number or a symbol of the image.
+ *
+ * @param f Filter to initialize
+ * @param spec Filter specification
+ * @param symbols Symbols to resolve addresses with
+ * @returns False if the specification was invalid
+ */
+bool tracefilter_init (tracefilter_t *f, const char *spec, symtab_t *symbols);
+
+/**
+ * @brief Decide whether to print the instruction just fetched
+ *
+ * Called once for every instruction, in order, from the trace fetch hook.
+ *
+ * @param f Filter to update
+ * @param m Machine about to execute the instruction
+ * @param inst Instruction fetched at m->cpu.pc
+ * @returns True if the instruction should be traced
+ */
+bool tracefilter_select (tracefilter_t *f, machine_t *m, y86_inst_t *inst);
+
+/**
+ * @brief Check whether the filter can select nothing before a stop point
+ *
+ * While this holds, the instructions up to tracefilter_skip's stop point can
+ * run untraced.
+ *
+ * @param f Filter to check
+ * @param m Machine about to execute its next instruction
+ * @returns True if the next instruction cannot be selected
+ */
+bool tracefilter_waiting (tracefilter_t *f, machine_t *m);
+
+/**
+ * @brief Run untraced up to the next instruction the filter must see
+ *
+ * Uses machine_run with no fetch hook and temporary breakpoints on the
+ * filter's addresses, so the skipped instructions run at full speed.
+ *
+ * @param f Filter being traced with
+ * @param m Machine to run (its fetch hook is restored afterwards)
+ * @param budget Maximum instructions to run (0 for no limit)
+ */
+void tracefilter_skip (tracefilter_t *f, machine_t *m, uint64_t budget);
+
+#endif
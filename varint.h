@@ -0,0 +1,61 @@
+#ifndef __CS261_VARINT__
+#define __CS261_VARINT__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "y86.h"
+
+/* signed values are stored as LEB128 of their zigzag encoding, which moves
+   the sign to bit 0 so that small differences either way take one or two
+   bytes; a 64-bit value takes at most VARINT_MAX bytes */
+#define VARINT_MAX 10
+
+/**
+ * @brief Write a signed value as a zigzag LEB128 varint
+ *
+ * @param out Where to write (room for VARINT_MAX bytes)
+ * @param v Value to write
+ * @returns The byte after the varint
+ */
+static inline byte_t *varint_put (byte_t *out, int64_t v)
+{
+    uint64_t z = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+
+    while (z >= 0x80) {
+        *out++ = (z & 0x7f) | 0x80;
+        z >>= 7;
+    }
+    *out++ = z;
+
+    return out;
+}
+
+/**
+ * @brief Read a zigzag LEB128 varint from a buffer
+ *
+ * @param buf Buffer holding the varint
+ * @param len Bytes in the buffer
+ * @param pos In: offset of the varint; out: offset after it (unchanged on
+ *        failure)
+ * @param v Value read
+ * @returns False if the buffer ends inside the varint or it runs past 64 bits
+ */
+static inline bool varint_get (const byte_t *buf, size_t len, size_t *pos,
+        int64_t *v)
+{
+    uint64_t z = 0;
+
+    for (size_t i = *pos, shift = 0; i < len && shift < 64; i++, shift += 7) {
+        z |= (uint64_t)(buf[i] & 0x7f) << shift;
+        if (!(buf[i] & 0x80)) {
+            *v = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+            *pos = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif